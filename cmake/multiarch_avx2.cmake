@@ -0,0 +1,47 @@
+# On x64 CPUs primecount's Sieve::count() uses GCC/Clang's
+# target attribute to compile an additional AVX2 version of
+# its bit counting kernel (Wojciech Mula's nibble lookup
+# table algorithm). At runtime the AVX2 kernel is only used
+# if the CPU supports it, otherwise the portable POPCNT
+# kernel is used.
+
+include(CheckCXXSourceCompiles)
+include(CMakePushCheckState)
+
+cmake_push_check_state()
+set(CMAKE_REQUIRED_INCLUDES "${PROJECT_SOURCE_DIR}/include")
+
+check_cxx_source_compiles("
+    #include <immintrin.h>
+    #include <stdint.h>
+
+    __attribute__ ((target (\"avx2\")))
+    uint64_t popcnt_avx2(const uint64_t* data, uint64_t size)
+    {
+        const __m256i lookup = _mm256_setr_epi8(
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i low_mask = _mm256_set1_epi8(0x0f);
+        __m256i vcnt = _mm256_setzero_si256();
+        for (uint64_t i = 0; i + 4 <= size; i += 4)
+        {
+            __m256i vec = _mm256_loadu_si256((const __m256i*) &data[i]);
+            __m256i lo = _mm256_and_si256(vec, low_mask);
+            __m256i hi = _mm256_and_si256(_mm256_srli_epi16(vec, 4), low_mask);
+            __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+            vcnt = _mm256_add_epi64(vcnt, _mm256_sad_epu8(cnt, _mm256_setzero_si256()));
+        }
+        return (uint64_t) _mm256_extract_epi64(vcnt, 0);
+    }
+
+    int main()
+    {
+        uint64_t data[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+        return (int) popcnt_avx2(&data[0], 8);
+    }" multiarch_avx2)
+
+if(multiarch_avx2)
+    set(ENABLE_MULTIARCH_AVX2 "ENABLE_MULTIARCH_AVX2")
+endif()
+
+cmake_pop_check_state()
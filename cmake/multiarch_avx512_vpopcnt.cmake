@@ -0,0 +1,39 @@
+# On x64 CPUs primecount's Sieve::count() uses GCC/Clang's
+# target attribute to compile an additional AVX512 VPOPCNT
+# version of its bit counting kernel. At runtime the AVX512
+# kernel is only used if the CPU supports it, otherwise the
+# portable POPCNT kernel is used.
+
+include(CheckCXXSourceCompiles)
+include(CMakePushCheckState)
+
+cmake_push_check_state()
+set(CMAKE_REQUIRED_INCLUDES "${PROJECT_SOURCE_DIR}/include")
+
+check_cxx_source_compiles("
+    #include <immintrin.h>
+    #include <stdint.h>
+
+    __attribute__ ((target (\"avx512f,avx512vpopcntdq\")))
+    uint64_t popcnt_avx512(const uint64_t* data, uint64_t size)
+    {
+        __m512i vcnt = _mm512_setzero_si512();
+        uint64_t i = 0;
+        for (; i + 8 <= size; i += 8)
+            vcnt = _mm512_add_epi64(vcnt, _mm512_popcnt_epi64(_mm512_loadu_si512(&data[i])));
+        __mmask8 mask = (__mmask8) (0xff >> (i + 8 - size));
+        vcnt = _mm512_add_epi64(vcnt, _mm512_popcnt_epi64(_mm512_maskz_loadu_epi64(mask, &data[i])));
+        return _mm512_reduce_add_epi64(vcnt);
+    }
+
+    int main()
+    {
+        uint64_t data[10] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+        return (int) popcnt_avx512(&data[0], 10);
+    }" multiarch_avx512_vpopcnt)
+
+if(multiarch_avx512_vpopcnt)
+    set(ENABLE_MULTIARCH_AVX512_VPOPCNT "ENABLE_MULTIARCH_AVX512_VPOPCNT")
+endif()
+
+cmake_pop_check_state()
@@ -17,15 +17,21 @@
 #define LOADBALANCERAC_HPP
 
 #include <OmpLock.hpp>
+#include <int128_t.hpp>
+#include <progress.hpp>
+
 #include <stdint.h>
+#include <condition_variable>
+#include <mutex>
 
 namespace primecount {
 
 class LoadBalancerAC
 {
 public:
-  LoadBalancerAC(int64_t sqrtx, int64_t y, int threads, bool is_print);
+  LoadBalancerAC(maxint_t x, int64_t sqrtx, int64_t y, int threads, bool is_print);
   bool get_work(int64_t& low, int64_t& high);
+  int64_t get_pi_low(int64_t low, int64_t high, int64_t count);
 
 private:
   void validate_segment_sizes();
@@ -33,6 +39,7 @@ private:
   void print_status();
 
   int64_t low_ = 0;
+  int64_t high_ = 0;
   int64_t sqrtx_ = 0;
   int64_t x14_ = 0;
   int64_t y_ = 0;
@@ -44,6 +51,16 @@ private:
   int threads_ = 0;
   bool is_print_ = false;
   OmpLock lock_;
+  Progress progress_;
+
+  // The segments are sieved in parallel, PrimePi[low] of
+  // each segment is passed on from the previous segment.
+  // All segments < pi_high_ have been sieved and
+  // pi_count_ = PrimePi[pi_high_ - 1].
+  int64_t pi_high_ = 0;
+  int64_t pi_count_ = 0;
+  std::mutex pi_mutex_;
+  std::condition_variable pi_cond_;
 };
 
 } // namespace
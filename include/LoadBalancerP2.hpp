@@ -15,21 +15,33 @@
 
 #include <int128_t.hpp>
 #include <OmpLock.hpp>
+#include <progress.hpp>
 
 #include <stdint.h>
+#include <string>
+#include <vector>
 
 namespace primecount {
 
 class LoadBalancerP2
 {
 public:
-  LoadBalancerP2(maxint_t x, int64_t sieve_limit, int threads, bool is_print);
+  LoadBalancerP2(const std::string& formula, maxint_t x, int64_t sieve_limit, int threads, bool is_print);
   bool get_work(int64_t& low, int64_t& high);
+  void finish_work(int64_t low, int64_t leaves, int64_t count);
+  maxint_t get_pi_low_sum();
   int get_threads() const;
 
 private:
   void print_status();
 
+  struct Chunk
+  {
+    int64_t low;
+    int64_t leaves;
+    int64_t count;
+  };
+
   int64_t low_ = 0;
   int64_t sieve_limit_ = 0;
   int64_t min_thread_dist_ = 0;
@@ -39,6 +51,8 @@ private:
   int precision_ = 0;
   bool is_print_ = false;
   OmpLock lock_;
+  Progress progress_;
+  std::vector<Chunk> chunks_;
 };
 
 } // namespace
@@ -11,21 +11,31 @@
 #define LOADBALANCERS2_HPP
 
 #include <primecount-internal.hpp>
+#include <primecount-config.hpp>
 #include <int128_t.hpp>
 #include <macros.hpp>
 #include <OmpLock.hpp>
+#include <progress.hpp>
 #include <StatusS2.hpp>
 
 #include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
 
 namespace primecount {
 
+class Backup;
+
 struct ThreadData
 {
   int64_t low = 0;
   int64_t segments = 0;
   int64_t segment_size = 0;
   maxint_t sum = 0;
+  // Sum of the thread's previous intervals that has not
+  // yet been added to the LoadBalancerS2's sum.
+  maxint_t unreported_sum = 0;
   double init_secs = 0;
   double secs = 0;
 
@@ -54,19 +64,67 @@ struct ThreadData
 class LoadBalancerS2
 {
 public:
-  LoadBalancerS2(maxint_t x, int64_t sieve_limit, maxint_t sum_approx, int threads, bool is_print);
+  LoadBalancerS2(const std::string& formula, maxint_t x, int64_t sieve_limit, maxint_t sum_approx, int threads, bool is_print);
   bool get_work(ThreadData& thread);
   maxint_t get_sum() const;
+  void resume(Backup& backup);
 
 private:
+  struct Interval
+  {
+    int64_t low;
+    int64_t segments;
+    int64_t segment_size;
+  };
+
+  struct Snapshot
+  {
+    int64_t id = 0;
+    int64_t low = 0;
+    int64_t max_low = 0;
+    int64_t segments = 0;
+    int64_t segment_size = 0;
+    maxint_t sum = 0;
+    std::vector<Interval> pending;
+  };
+
+  struct ProgressData
+  {
+    ThreadData thread;
+    int64_t high = 0;
+    int64_t segments = 0;
+    int64_t segment_size = 0;
+    maxint_t sum = 0;
+    double remaining_secs = 0;
+  };
+
+  bool get_work_locked(ThreadData& thread);
+  bool get_work_lockfree(ThreadData& thread);
+  void fit_shard(ThreadData& thread) const;
+  void publish_work();
+  void backup(const Snapshot& snapshot);
+  void finished(int64_t low);
+  void print_status(int64_t high, maxint_t sum);
+  void print_progress(const ProgressData& data);
   void update_load_balancing(const ThreadData& thread);
   void update_number_of_segments(const ThreadData& thread);
   void update_segment_size();
   double remaining_secs() const;
 
-  int64_t low_ = 0;
+  // Next unassigned low, the threads claim their
+  // intervals using compare and swap.
+  MAYBE_UNUSED char pad1_[MAX_CACHE_LINE_SIZE];
+  std::atomic<int64_t> low_;
+  // segments_ (high 32 bits) and segment_size_ (low 32
+  // bits) that are read by the threads without locking.
+  std::atomic<uint64_t> work_;
+  MAYBE_UNUSED char pad2_[MAX_CACHE_LINE_SIZE];
   int64_t max_low_ = 0;
   int64_t sieve_limit_ = 0;
+  // [shard_low_, shard_high_[ is the part of the
+  // sieving interval computed by this process.
+  int64_t shard_low_ = 0;
+  int64_t shard_high_ = 0;
   int64_t segments_ = 0;
   int64_t segment_size_ = 0;
   int64_t max_size_ = 0;
@@ -75,7 +133,19 @@ private:
   double time_ = 0;
   bool is_print_ = false;
   StatusS2 status_;
+  Progress progress_;
   OmpLock lock_;
+  OmpLock print_lock_;
+  OmpLock backup_lock_;
+  // Intervals that are currently being sieved
+  std::vector<Interval> in_flight_;
+  // Unfinished intervals of a resumed computation
+  std::vector<Interval> pending_;
+  Backup* backup_ = nullptr;
+  std::string formula_;
+  double backup_time_ = 0;
+  int64_t snapshot_id_ = 0;
+  int64_t backup_id_ = 0;
 };
 
 } // namespace
@@ -1,7 +1,7 @@
 ///
 /// @file   OmpLock.hpp
-/// @brief  The OmpLock and LockGuard classes are RAII-style
-///         wrappers for OpenMP locks.
+/// @brief  The OmpLock, LockGuard and TryLockGuard classes are
+///         RAII-style wrappers for OpenMP locks.
 ///
 /// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
 ///
@@ -20,14 +20,18 @@
 #else
 
 // If OpenMP is disabled we define the functions used by
-// the OmpLock and LockGuard classes as no-op.
+// the OmpLock and lock guard classes (and by the load
+// balancers) as no-op.
 namespace {
 
 using omp_lock_t = int;
 
+inline int omp_get_thread_num() { return 0; }
+
 inline void omp_init_lock(omp_lock_t*) { }
 inline void omp_destroy_lock(omp_lock_t*) { }
 inline void omp_set_lock(omp_lock_t*) { }
+inline int omp_test_lock(omp_lock_t*) { return 1; }
 inline void omp_unset_lock(omp_lock_t*) { }
 
 } // namespace
@@ -93,6 +97,41 @@ private:
   omp_lock_t* lock_ = nullptr;
 };
 
+/// Non-blocking lock guard, if the lock is currently
+/// held by another thread owns_lock() returns false.
+///
+class TryLockGuard
+{
+public:
+  TryLockGuard(OmpLock& lock)
+  {
+    ASSERT(lock.is_initialized());
+
+    if (lock.threads_ <= 1)
+      owns_lock_ = true;
+    else if (omp_test_lock(&lock.lock_))
+    {
+      lock_ = &lock.lock_;
+      owns_lock_ = true;
+    }
+  }
+
+  ~TryLockGuard()
+  {
+    if (lock_)
+      omp_unset_lock(lock_);
+  }
+
+  bool owns_lock() const
+  {
+    return owns_lock_;
+  }
+
+private:
+  omp_lock_t* lock_ = nullptr;
+  bool owns_lock_ = false;
+};
+
 } // namespace
 
 #endif
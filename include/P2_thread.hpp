@@ -0,0 +1,92 @@
+///
+/// @file  P2_thread.hpp
+/// @brief The P2(x, a) and B(x, y) formulas both compute
+///        \sum pi(x / prime) for y < prime <= x^(1/2). Each thread
+///        sieves a chunk [low, high[ of the interval
+///        [x^(1/2), x / y[ using primesieve::iterator and
+///        counts the primes <= x / prime.
+///
+///        The threads do not compute pi(low - 1) of their chunk,
+///        instead pi(x / prime) is computed relative to the start
+///        of the chunk. Once all chunks have been sieved
+///        LoadBalancerP2 adds up the prime counts of the
+///        preceding chunks, hence pi(low - 1) is only computed
+///        once for the first chunk.
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#ifndef P2_THREAD_HPP
+#define P2_THREAD_HPP
+
+#include <LoadBalancerP2.hpp>
+#include <primesieve.hpp>
+#include <imath.hpp>
+#include <macros.hpp>
+#include <min.hpp>
+#include <profiling.hpp>
+
+#include <stdint.h>
+
+namespace primecount {
+
+/// Thread sieves [low, high[ and returns the sum of
+/// pi(x / prime) - pi(low - 1) for the primes with
+/// low <= x / prime < high.
+///
+template <typename T>
+T P2_thread(T x,
+            int64_t y,
+            int64_t low,
+            int64_t high,
+            LoadBalancerP2& loadBalancer)
+{
+  ASSERT(low > 0);
+  ASSERT(low < high);
+  int64_t sqrtx = isqrt(x);
+  int64_t start = max(y, min(x / high, sqrtx));
+  int64_t stop = min(x / low, sqrtx);
+  primesieve::iterator it1(stop, start);
+  primesieve::iterator it2(low, high);
+  it2.generate_next_primes();
+  int64_t prime = it1.prev_prime();
+  int64_t leaves = 0;
+  int64_t count = 0;
+  T sum = 0;
+
+  // \sum_{i = pi[start]+1}^{pi[stop]} pi(x / primes[i])
+  for (; prime > start; prime = it1.prev_prime())
+  {
+    uint64_t xp = (uint64_t)(x / prime);
+
+    for (; it2.primes_[it2.size_ - 1] <= xp; it2.generate_next_primes())
+      count += it2.size_ - it2.i_;
+    for (; it2.primes_[it2.i_] <= xp; it2.i_++)
+      count += 1;
+
+    sum += count;
+    leaves++;
+    PROFILE_ADD(PROFILE_LEAVES, 1);
+    PROFILE_ADD(PROFILE_DIVISIONS, 1);
+  }
+
+  // Count the remaining primes < high
+  // which are needed by the next chunk.
+  uint64_t max_prime = high - 1;
+
+  for (; it2.primes_[it2.size_ - 1] <= max_prime; it2.generate_next_primes())
+    count += it2.size_ - it2.i_;
+  for (; it2.primes_[it2.i_] <= max_prime; it2.i_++)
+    count += 1;
+
+  loadBalancer.finish_work(low, leaves, count);
+
+  return sum;
+}
+
+} // namespace
+
+#endif
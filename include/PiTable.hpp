@@ -18,11 +18,13 @@
 #define PITABLE_HPP
 
 #include <BitSieve240.hpp>
+#include <PiTableCache.hpp>
 #include <popcnt.hpp>
 #include <macros.hpp>
 #include <pod_vector.hpp>
 
 #include <stdint.h>
+#include <memory>
 
 namespace primecount {
 
@@ -30,6 +32,8 @@ class PiTable : public BitSieve240
 {
 public:
   PiTable(uint64_t max_x, int threads);
+  PiTable(const PiTable&) = delete;
+  PiTable& operator=(const PiTable&) = delete;
 
   uint64_t size() const
   {
@@ -49,8 +53,8 @@ public:
     if_unlikely(x < pi_tiny_.size())
       return pi_tiny_[x];
 
-    uint64_t count = pi_[x / 240].count;
-    uint64_t bits = pi_[x / 240].bits;
+    uint64_t count = pi_data_[x / 240].count;
+    uint64_t bits = pi_data_[x / 240].bits;
     uint64_t bitmask = unset_larger_[x % 240];
     return count + popcnt64(bits & bitmask);
   }
@@ -81,6 +85,9 @@ private:
   pod_vector<pi_t> pi_;
   pod_vector<uint64_t> counts_;
   uint64_t max_x_;
+  // Points to pi_ or to the cache file
+  const pi_t* pi_data_ = nullptr;
+  std::shared_ptr<const PiTableFile> file_;
 };
 
 } // namespace
@@ -0,0 +1,70 @@
+///
+/// @file  PiTableCache.hpp
+/// @brief Optional on-disk cache for the PiTable. Building a large
+///        PiTable requires sieving up to y or sqrt(x), when many
+///        pi(x) computations of similar magnitude are run this
+///        work is repeated over and over again. If a cache
+///        directory has been set (--cache-dir=DIR) the largest
+///        PiTable computed so far is stored in a versioned and
+///        checksummed file which is memory mapped read-only by
+///        all subsequent PiTables that it covers (from all threads
+///        and processes).
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#ifndef PITABLECACHE_HPP
+#define PITABLECACHE_HPP
+
+#include <pod_vector.hpp>
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+
+namespace primecount {
+
+/// Read-only view of a cached PiTable file. The data consists
+/// of { count, bits } pairs of 64-bit words, one pair for each
+/// interval of size 240, see PiTable.hpp.
+///
+class PiTableFile
+{
+public:
+  ~PiTableFile();
+  PiTableFile(const PiTableFile&) = delete;
+  PiTableFile& operator=(const PiTableFile&) = delete;
+
+  const uint64_t* data() const
+  {
+    return data_;
+  }
+
+  uint64_t max_x() const
+  {
+    return max_x_;
+  }
+
+  static std::shared_ptr<const PiTableFile> load(uint64_t max_x);
+  static void store(const uint64_t* data, uint64_t max_x);
+  static std::string filename();
+
+private:
+  PiTableFile() = default;
+  static std::shared_ptr<const PiTableFile> open(const std::string& filename);
+
+  const uint64_t* data_ = nullptr;
+  uint64_t max_x_ = 0;
+  // Used if the file is memory mapped
+  void* map_ = nullptr;
+  std::size_t map_size_ = 0;
+  // Used if memory mapping is not supported
+  pod_vector<uint64_t> buffer_;
+};
+
+} // namespace
+
+#endif
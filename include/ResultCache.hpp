@@ -0,0 +1,56 @@
+///
+/// @file  ResultCache.hpp
+/// @brief Optional persistent cache for the results of pi(x),
+///        nth_prime(n) and phi(x, a). If a cache directory has
+///        been set (--cache-dir=DIR) the results of large
+///        computations are appended to DIR/primecount-results.txt
+///        and repeated queries (also from later processes) are
+///        answered without recomputing them. The most recently
+///        used results are kept in a bounded in-process LRU
+///        cache, the lines appended to the cache file are only
+///        read once unless results have been evicted.
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#ifndef RESULTCACHE_HPP
+#define RESULTCACHE_HPP
+
+#include <primecount-internal.hpp>
+#include <int128_t.hpp>
+#include <to_string.hpp>
+
+#include <stdint.h>
+#include <string>
+
+namespace primecount {
+
+/// Computations with x < min_cached_x take only a few
+/// milliseconds, for these the cache is not used.
+///
+constexpr int64_t min_cached_x = 10000000000ll;
+
+bool get_cached_result(const std::string& key, std::string& value);
+void set_cached_result(const std::string& key, const std::string& value);
+
+/// Returns the cached result of key e.g. "pi(1000)",
+/// else compute the result and add it to the cache.
+///
+template <typename T, typename F>
+T cached_result(const std::string& key, F compute)
+{
+  std::string value;
+  if (get_cached_result(key, value))
+    return (T) to_maxint(value);
+
+  T res = compute();
+  set_cached_result(key, to_string((maxint_t) res));
+  return res;
+}
+
+} // namespace
+
+#endif
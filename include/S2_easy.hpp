@@ -0,0 +1,128 @@
+///
+/// @file  S2_easy.hpp
+/// @brief Parallel loop over the b's of the easy special leaves,
+///        shared by S2_easy.cpp and S2_easy_libdivide.cpp.
+///
+///        If backups are enabled the b's are processed in chunks
+///        and the progress is stored after each chunk. Once all
+///        threads have finished their chunk the next b and the
+///        sum of all previous b's are in a consistent state.
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#ifndef S2_EASY_HPP
+#define S2_EASY_HPP
+
+#include <backup.hpp>
+#include <primecount-internal.hpp>
+#include <int128_t.hpp>
+#include <min.hpp>
+#include <RelaxedAtomic.hpp>
+#include <StatusS2.hpp>
+#include <progress.hpp>
+#include <to_string.hpp>
+
+#include <stdint.h>
+#include <map>
+#include <string>
+
+namespace primecount {
+
+/// Returns \sum_{b = start_b}^{pi_x13} leaves(b) where
+/// leaves(b) is the contribution of the easy special
+/// leaves of the b-th prime.
+///
+template <typename T, typename Leaves>
+T S2_easy_chunks(T x,
+                 int64_t y,
+                 int64_t start_b,
+                 int64_t pi_x13,
+                 Backup& backup,
+                 int threads,
+                 bool is_print,
+                 Leaves leaves)
+{
+  T sum = 0;
+  int64_t chunk_size = pi_x13;
+  StatusS2 status(x);
+  Progress progress("S2_easy", x);
+
+  if (backup.is_enabled())
+  {
+    chunk_size = threads;
+    int64_t backup_y = 0;
+    int64_t backup_b = 0;
+    maxint_t backup_sum = 0;
+
+    if (backup.get("S2_easy.y", backup_y) &&
+        backup.get("S2_easy.b", backup_b) &&
+        backup.get("S2_easy.sum", backup_sum) &&
+        backup_y == y)
+    {
+      start_b = backup_b;
+      sum = (T) backup_sum;
+    }
+  }
+
+  // for (b = pi[sqrty] + 1; b <= pi_x13; b++)
+  while (start_b <= pi_x13)
+  {
+    double time = get_time();
+    int64_t stop_b = min(start_b + chunk_size - 1, pi_x13);
+    RelaxedAtomic<int64_t> min_b(start_b);
+
+    #pragma omp parallel num_threads(threads) reduction(+: sum)
+    for (int64_t b = min_b++; b <= stop_b; b = min_b++)
+    {
+      sum += leaves(b);
+
+      #pragma omp master
+      {
+        if (is_print)
+          status.print(b, pi_x13);
+
+        if (progress.is_due())
+        {
+          double percent = StatusS2::getPercent(b, pi_x13);
+
+          progress.line("progress")
+            .add_double("percent", percent)
+            .add_double("remaining_secs", progress.remaining_secs(percent))
+            .write();
+        }
+      }
+    }
+
+    start_b = stop_b + 1;
+
+    if (backup.is_enabled())
+    {
+      std::map<std::string, std::string> values;
+      values["S2_easy.y"] = std::to_string(y);
+      values["S2_easy.b"] = std::to_string(start_b);
+      values["S2_easy.sum"] = to_string((maxint_t) sum);
+      backup.set(values);
+
+      // Increase the chunk size until
+      // processing a chunk takes longer than
+      // the backup interval.
+      if (get_time() - time < get_backup_interval())
+        chunk_size *= 2;
+    }
+  }
+
+  // The S2_easy.* keys store the progress of
+  // S2_easy(x, y) which is not needed anymore.
+  backup.set("S2_easy", (maxint_t) sum);
+  backup.erase("S2_easy.");
+
+  return sum;
+}
+
+} // namespace
+
+#endif
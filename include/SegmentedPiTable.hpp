@@ -41,6 +41,9 @@ class SegmentedPiTable : public BitSieve240
 {
 public:
   void init(uint64_t low, uint64_t high);
+  uint64_t init_bits(uint64_t low, uint64_t high);
+  void init_count(uint64_t pi_low);
+  static uint64_t get_pi_low(uint64_t low, int threads);
 
   int64_t low() const
   {
@@ -85,9 +88,6 @@ public:
   }
 
 private:
-  void init_bits();
-  void init_count(uint64_t pi_low);
-
   struct pi_t
   {
     uint64_t count;
@@ -24,6 +24,10 @@
 ///        branch mispredictions. For this reason this implementation
 ///        instead uses a linear counter array whose elements contain
 ///        the total count of unsieved elements in a certain interval.
+///        If the leaves are sparse (large distance between consecutive
+///        leaves) a second, coarser counter array is used on top of
+///        the first one, this way count(stop) skips over large
+///        intervals using few additions.
 ///
 ///        In-depth description of this algorithm:
 ///        https://github.com/kimwalisch/primecount/blob/master/doc/Hard-Special-Leaves.md
@@ -37,6 +41,8 @@
 #ifndef SIEVE_HPP
 #define SIEVE_HPP
 
+#include <primecount-config.hpp>
+#include <min.hpp>
 #include <pod_vector.hpp>
 #include <stdint.h>
 
@@ -49,6 +55,14 @@ public:
   void cross_off(uint64_t prime, uint64_t i);
   void cross_off_count(uint64_t prime, uint64_t i);
   static uint64_t get_segment_size(uint64_t size);
+  static const char* get_count_kernel();
+  static uint64_t popcnt_default(const uint64_t* data, uint64_t size);
+#if defined(ENABLE_MULTIARCH_AVX512_VPOPCNT)
+  static uint64_t popcnt_avx512(const uint64_t* data, uint64_t size);
+#endif
+#if defined(ENABLE_MULTIARCH_AVX2)
+  static uint64_t popcnt_avx2(const uint64_t* data, uint64_t size);
+#endif
   uint64_t count(uint64_t start, uint64_t stop) const;
   uint64_t count(uint64_t stop);
 
@@ -61,18 +75,45 @@ public:
   void pre_sieve(const pod_vector<T>& primes, uint64_t c, uint64_t low, uint64_t high)
   {
     reset_sieve(low, high);
+    uint64_t i = 4;
+    uint64_t sieve_size = sieve_.size();
+    uint64_t block_size = L1D_CACHE_SIZE / 2;
+
+    // If the sieve array is larger than the L1 cache we
+    // cross off the small sieving primes (which have more
+    // than 32 multiples per block) block by block. This
+    // way each block is loaded only once into the L1 cache
+    // instead of once per sieving prime.
+    if (sieve_size > block_size)
+    {
+      uint64_t last = i;
+      for (; last <= c && (uint64_t) primes[last] < block_size / 4; last++);
+
+      for (uint64_t start = 0; start < sieve_size; start += block_size)
+      {
+        uint64_t size = min(block_size, sieve_size - start);
+        for (uint64_t j = i; j < last; j++)
+          cross_off(primes[j], j, start, size);
+      }
 
-    for (uint64_t i = 4; i <= c; i++)
+      i = last;
+    }
+
+    for (; i <= c; i++)
       cross_off(primes[i], i);
 
-    init_counter(low, high);
+    init_counter();
   }
 
 private:
   void add(uint64_t prime);
-  void allocate_counter(uint64_t low);
-  void init_counter(uint64_t low, uint64_t high);
+  template <bool TWO_LEVEL_COUNTER>
+  void cross_off_count(uint64_t prime, uint64_t i);
+  void cross_off(uint64_t prime, uint64_t i, uint64_t start, uint64_t size);
+  void allocate_counter(double average_leaf_dist);
+  void init_counter();
   void reset_counter();
+  void update_counter();
   void reset_sieve(uint64_t low, uint64_t high);
   uint64_t segment_size() const;
 
@@ -95,7 +136,11 @@ private:
     uint64_t log2_dist = 0;
     uint64_t sum = 0;
     uint64_t i = 0;
+    uint64_t log2_ratio = 0;
     pod_vector<uint32_t> counter;
+    // blocks[j] = sum of counter[j * ratio ... (j + 1) * ratio - 1],
+    // only used if the leaves are sparse.
+    pod_vector<uint32_t> blocks;
 
     uint32_t& operator[](std::size_t pos)
     {
@@ -112,6 +157,8 @@ private:
   uint64_t prev_stop_ = 0;
   uint64_t count_ = 0;
   uint64_t total_count_ = 0;
+  uint64_t leaves_ = 0;
+  uint64_t leaf_dist_ = 0;
   pod_vector<uint8_t> sieve_;
   pod_vector<Wheel> wheel_;
   Counter counter_;
@@ -21,6 +21,7 @@ public:
   void print(int64_t b, int64_t max_b);
   void print(int64_t low, int64_t limit, maxint_t sum, maxint_t sum_approx);
   static double getPercent(int64_t low, int64_t limit, maxint_t sum, maxint_t sum_approx);
+  static double getPercent(int64_t b, int64_t max_b);
 private:
   void print(double percent);
   double epsilon_ = 0;
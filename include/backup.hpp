@@ -0,0 +1,119 @@
+///
+/// @file  backup.hpp
+/// @brief The Backup class stores the results of the partial
+///        formulas of a long running pi(x) computation (as well as
+///        the progress of the formulas that are still running) in a
+///        small text file. If the computation is interrupted (e.g.
+///        because the server is rebooted) it can later be resumed
+///        from the last consistent state using --resume.
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#ifndef BACKUP_HPP
+#define BACKUP_HPP
+
+#include <int128_t.hpp>
+#include <print.hpp>
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace primecount {
+
+void set_backup_file(const std::string& filename);
+void set_backup_interval(double seconds);
+void set_resume(bool resume);
+const std::string& get_backup_file();
+double get_backup_interval();
+bool is_resume();
+
+/// In distributed mode the sieving interval of D(x, y),
+/// AC(x, y) and S2_hard(x, y) is split into N shards which
+/// are computed by independent primecount processes. Each
+/// shard stores its partial result in its backup file and
+/// merge_shards() finally adds up the partial results.
+///
+void set_shard(int shard, int shards);
+int get_shard();
+int get_shards();
+bool is_shard();
+bool is_shard(maxint_t x);
+std::pair<int64_t, int64_t> get_shard_range(maxint_t x, int64_t limit);
+std::string get_shard_backup_file();
+maxint_t merge_shards(const std::vector<std::string>& filenames);
+
+/// Each computation (e.g. pi_gourdon(x)) that should be backed up
+/// creates a Backup object. Only the outermost computation owns
+/// the backup file, all nested computations that use the same x
+/// (e.g. D(x) inside of pi_gourdon(x)) share the backup file of
+/// their parent. Nested computations with a different x, e.g.
+/// pi(x / prime) inside of B(x), are never backed up.
+///
+class Backup
+{
+public:
+  Backup(const std::string& formula, maxint_t x);
+  ~Backup();
+  bool is_enabled() const;
+  bool get(const std::string& key, maxint_t& value) const;
+  bool get(const std::string& key, std::string& value) const;
+  void set(const std::string& key, maxint_t value);
+  void set(const std::string& key, const std::string& value);
+  void set(const std::map<std::string, std::string>& values);
+  void erase(const std::string& key_prefix);
+  void save() const;
+
+  template <typename T>
+  bool get(const std::string& key, T& value) const
+  {
+    maxint_t n;
+    if (!get(key, n))
+      return false;
+    value = (T) n;
+    return true;
+  }
+
+  /// If the computation has been resumed we load the result
+  /// of the formula from the backup file, else we compute the
+  /// formula and store its result in the backup file.
+  ///
+  template <typename T, typename F>
+  T get_or_compute(const std::string& formula, bool is_print, F compute)
+  {
+    T res;
+
+    if (get(formula, res))
+    {
+      if (is_print)
+      {
+        std::string str = formula + " (resumed)";
+        print("");
+        print(str.c_str(), res);
+      }
+
+      return res;
+    }
+
+    res = compute();
+    set(formula, res);
+    return res;
+  }
+
+  static std::map<std::string, std::string> read(const std::string& filename);
+
+private:
+  std::map<std::string, std::string> values_;
+  bool is_enabled_ = false;
+  bool is_owner_ = false;
+};
+
+} // namespace
+
+#endif
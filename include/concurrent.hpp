@@ -0,0 +1,115 @@
+///
+/// @file  concurrent.hpp
+/// @brief Compute 2 independent formulas concurrently, e.g. D(x)
+///        and A + C, B in Gourdon's algorithm. Each formula uses
+///        its own OpenMP thread team (nested parallelism) and the
+///        threads are split proportionally to the estimated run
+///        time of the formulas. When computing the formulas one
+///        after the other most CPU cores are idle near the end of
+///        each formula while the last threads are finishing. When
+///        computing the formulas concurrently the other formula
+///        keeps running meanwhile.
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#ifndef CONCURRENT_HPP
+#define CONCURRENT_HPP
+
+#include <primecount-internal.hpp>
+#include <progress.hpp>
+#include <int128_t.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+
+#if defined(_OPENMP)
+  #include <omp.h>
+#endif
+
+namespace primecount {
+
+/// Returns true if independent formulas should be computed
+/// concurrently. This is only worth it for large computations
+/// using many threads. When printing or progress reporting is
+/// enabled the formulas are computed one after the other as
+/// the status estimates of D(x) and S2_hard(x) depend on the
+/// results of the other formulas. We also never use nested
+/// concurrency, e.g. pi(x / p) inside of B(x).
+///
+inline bool is_concurrent(maxint_t x, int threads, bool is_print)
+{
+#if defined(_OPENMP) && \
+   !defined(ENABLE_PROFILING)
+  return x >= (maxint_t) 1e15 &&
+         threads >= 4 &&
+         !is_print &&
+         !is_progress() &&
+         omp_get_active_level() == 0;
+#else
+  // The profiling counters cannot be attributed
+  // to formulas which run concurrently.
+  (void) x;
+  (void) threads;
+  (void) is_print;
+  return false;
+#endif
+}
+
+/// Number of threads of a formula whose estimated
+/// run time is share * (total run time). Rounding up
+/// gives the formula a slight priority.
+///
+inline int concurrent_threads(int threads, double share)
+{
+  int t = (int) std::ceil(threads * share);
+  return in_between(1, t, threads - 1);
+}
+
+/// Run f1(threads1) and f2(threads2) concurrently.
+/// Exceptions must not escape an OpenMP parallel region,
+/// hence they are rethrown after both formulas finished.
+///
+template <typename F1, typename F2>
+void run_concurrently(F1 f1, int threads1, F2 f2, int threads2)
+{
+#if defined(_OPENMP)
+  int max_levels = omp_get_max_active_levels();
+  omp_set_max_active_levels(std::max(max_levels, 2));
+  std::exception_ptr error1;
+  std::exception_ptr error2;
+
+  #pragma omp parallel sections num_threads(2)
+  {
+    #pragma omp section
+    {
+      try { f1(threads1); }
+      catch (...) { error1 = std::current_exception(); }
+    }
+
+    #pragma omp section
+    {
+      try { f2(threads2); }
+      catch (...) { error2 = std::current_exception(); }
+    }
+  }
+
+  omp_set_max_active_levels(max_levels);
+
+  if (error1)
+    std::rethrow_exception(error1);
+  if (error2)
+    std::rethrow_exception(error2);
+#else
+  f1(threads1);
+  f2(threads2);
+#endif
+}
+
+} // namespace
+
+#endif
@@ -0,0 +1,259 @@
+///
+/// @file  cpuid.hpp
+/// @brief Detect the CPU's features at runtime using the CPUID
+///        instruction. This allows distributing a single portable
+///        primecount binary that uses the fastest instructions
+///        (POPCNT, AVX2, AVX512) supported by the CPU it runs on.
+///
+///        All functions return false on CPU architectures without
+///        CPUID, in this case primecount uses the instructions
+///        that have been enabled at compile time.
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#ifndef CPUID_HPP
+#define CPUID_HPP
+
+#include <stdint.h>
+#include <cstring>
+#include <string>
+
+#if defined(__i386__) || \
+    defined(__x86_64__) || \
+    defined(_M_IX86) || \
+    defined(_M_X64)
+  #define HAS_CPUID
+#endif
+
+#if defined(HAS_CPUID) && \
+    defined(_MSC_VER)
+  #include <intrin.h>
+  #include <immintrin.h>
+#endif
+
+namespace primecount {
+
+#if defined(HAS_CPUID)
+
+/// CPUID bit flags, these must not be macros as they
+/// would clash with the bit_* macros of <cpuid.h>.
+///
+namespace cpuid_bit {
+
+// %ebx bit flags
+constexpr int AVX2 = 1 << 5;
+constexpr int AVX512F = 1 << 16;
+
+// %ecx bit flags
+constexpr int AVX512_VPOPCNTDQ = 1 << 14;
+constexpr int POPCNT = 1 << 23;
+constexpr int OSXSAVE = 1 << 27;
+constexpr int AVX = 1 << 28;
+
+// xgetbv bit flags
+constexpr int XSTATE_SSE = 1 << 1;
+constexpr int XSTATE_YMM = 1 << 2;
+constexpr int XSTATE_ZMM = 7 << 5;
+
+} // namespace cpuid_bit
+
+inline void run_cpuid(int eax, int ecx, int* abcd)
+{
+#if defined(_MSC_VER)
+  __cpuidex(abcd, eax, ecx);
+#else
+  int ebx = 0;
+  int edx = 0;
+
+  #if defined(__i386__) && \
+      defined(__PIC__)
+    /* in case of PIC under 32-bit EBX cannot be clobbered */
+    __asm__ ("movl %%ebx, %%edi;"
+             "cpuid;"
+             "xchgl %%ebx, %%edi;"
+             : "=D" (ebx),
+               "+a" (eax),
+               "+c" (ecx),
+               "=d" (edx));
+  #else
+    __asm__ ("cpuid;"
+             : "+b" (ebx),
+               "+a" (eax),
+               "+c" (ecx),
+               "=d" (edx));
+  #endif
+
+  abcd[0] = eax;
+  abcd[1] = ebx;
+  abcd[2] = ecx;
+  abcd[3] = edx;
+#endif
+}
+
+/// Get value of extended control register
+inline int get_xcr0()
+{
+  int xcr0;
+
+#if defined(_MSC_VER)
+  xcr0 = (int) _xgetbv(0);
+#else
+  __asm__ ("xgetbv" : "=a" (xcr0) : "c" (0) : "%edx" );
+#endif
+
+  return xcr0;
+}
+
+inline int get_max_leaf()
+{
+  int abcd[4];
+  run_cpuid(0, 0, abcd);
+  return abcd[0];
+}
+
+inline bool has_cpuid_popcnt()
+{
+  int abcd[4];
+  run_cpuid(1, 0, abcd);
+  return (abcd[2] & cpuid_bit::POPCNT) == cpuid_bit::POPCNT;
+}
+
+/// Returns true if the CPU and the OS support saving
+/// the registers given by the xstate mask.
+///
+inline bool has_os_xstate(int xstate_mask)
+{
+  int abcd[4];
+  run_cpuid(1, 0, abcd);
+
+  // Ensure OS supports extended processor state management
+  if ((abcd[2] & cpuid_bit::OSXSAVE) != cpuid_bit::OSXSAVE ||
+      (abcd[2] & cpuid_bit::AVX) != cpuid_bit::AVX)
+    return false;
+
+  return (get_xcr0() & xstate_mask) == xstate_mask;
+}
+
+inline bool has_cpuid_avx2()
+{
+  if (get_max_leaf() < 7 ||
+      !has_os_xstate(cpuid_bit::XSTATE_SSE | cpuid_bit::XSTATE_YMM))
+    return false;
+
+  int abcd[4];
+  run_cpuid(7, 0, abcd);
+  return (abcd[1] & cpuid_bit::AVX2) == cpuid_bit::AVX2;
+}
+
+inline bool has_cpuid_avx512_vpopcnt()
+{
+  if (get_max_leaf() < 7 ||
+      !has_os_xstate(cpuid_bit::XSTATE_SSE |
+                     cpuid_bit::XSTATE_YMM |
+                     cpuid_bit::XSTATE_ZMM))
+    return false;
+
+  int abcd[4];
+  run_cpuid(7, 0, abcd);
+  return (abcd[1] & cpuid_bit::AVX512F) == cpuid_bit::AVX512F &&
+         (abcd[2] & cpuid_bit::AVX512_VPOPCNTDQ) == cpuid_bit::AVX512_VPOPCNTDQ;
+}
+
+/// Returns "GenuineIntel", "AuthenticAMD", ...
+inline std::string get_cpu_vendor()
+{
+  int abcd[4];
+  char vendor[13] = { 0 };
+  run_cpuid(0, 0, abcd);
+  std::memcpy(&vendor[0], &abcd[1], 4);
+  std::memcpy(&vendor[4], &abcd[3], 4);
+  std::memcpy(&vendor[8], &abcd[2], 4);
+  return vendor;
+}
+
+/// Returns the CPU's display family and model
+inline void get_cpu_family_model(int& family, int& model)
+{
+  int abcd[4];
+  run_cpuid(1, 0, abcd);
+  family = (abcd[0] >> 8) & 0xf;
+  model = (abcd[0] >> 4) & 0xf;
+
+  if (family == 0xf)
+    family += (abcd[0] >> 20) & 0xff;
+  if (family == 0x6 || family >= 0xf)
+    model += ((abcd[0] >> 16) & 0xf) << 4;
+}
+
+/// On x64 CPUs 64-bit integer division used to be much slower
+/// than 32-bit integer division. This has been fixed in Intel
+/// Ice Lake (2019) and later and in AMD Zen3 (2020) and later.
+/// For unknown CPUs we return false as using 32-bit division
+/// whenever possible is fast on all CPUs.
+///
+inline bool has_fast_div64()
+{
+  int family;
+  int model;
+  get_cpu_family_model(family, model);
+  std::string vendor = get_cpu_vendor();
+
+  if (vendor == "AuthenticAMD" ||
+      vendor == "HygonGenuine")
+    return family >= 0x19;
+
+  if (vendor == "GenuineIntel")
+  {
+    if (family > 0x6)
+      return true;
+    if (family < 0x6)
+      return false;
+
+    switch (model)
+    {
+      case 0x6A: // Ice Lake-SP
+      case 0x6C: // Ice Lake-D
+      case 0x7D: // Ice Lake
+      case 0x7E: // Ice Lake
+      case 0x8C: // Tiger Lake
+      case 0x8D: // Tiger Lake
+      case 0x8F: // Sapphire Rapids
+      case 0x97: // Alder Lake
+      case 0x9A: // Alder Lake
+      case 0xA7: // Rocket Lake
+      case 0xAA: // Meteor Lake
+      case 0xAC: // Meteor Lake
+      case 0xAD: // Granite Rapids
+      case 0xAE: // Granite Rapids
+      case 0xB7: // Raptor Lake
+      case 0xBA: // Raptor Lake
+      case 0xBD: // Lunar Lake
+      case 0xBF: // Raptor Lake
+      case 0xC5: // Arrow Lake
+      case 0xC6: // Arrow Lake
+      case 0xCF: // Emerald Rapids
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  return false;
+}
+
+#else
+
+inline bool has_cpuid_popcnt() { return false; }
+inline bool has_cpuid_avx2() { return false; }
+inline bool has_cpuid_avx512_vpopcnt() { return false; }
+inline bool has_fast_div64() { return false; }
+
+#endif
+
+} // namespace
+
+#endif
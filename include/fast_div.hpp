@@ -11,11 +11,13 @@
 ///        most CPUs before 2020 this significantly improves
 ///        performance.
 ///
-///        On some new CPUs (such as Intel Cannonlake) 64-bit integer
+///        On some new CPUs (such as Intel Ice Lake) 64-bit integer
 ///        division has been improved significantly and runs as fast
-///        as 32-bit integer division. For such CPUs it is best to
-///        disable ENABLE_DIV32 (using cmake -DWITH_DIV32=OFF) as this
-///        avoids runtime checks for (64-bit / 32-bit) divisions.
+///        as 32-bit integer division. On x86 we detect such CPUs at
+///        runtime using CPUID (see has_fast_div64() in cpuid.hpp)
+///        and skip the runtime checks for (64-bit / 32-bit)
+///        divisions. The checks can also be removed at compile time
+///        using cmake -DWITH_DIV32=OFF.
 ///
 /// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
 ///
@@ -27,17 +29,32 @@
 #define FAST_DIV_HPP
 
 #include <macros.hpp>
+#include <profiling.hpp>
 
 #include <limits>
 #include <stdint.h>
 #include <type_traits>
 
+#if defined(ENABLE_DIV32)
+
+namespace primecount {
+
+/// Use 32-bit division if the CPU's 64-bit division
+/// is slow, detected using CPUID in cpu_info.cpp.
+///
+extern const bool is_div32;
+
+} // namespace
+
+#endif
+
 namespace {
 
 /// If ENABLE_DIV32 is defined:
 ///
 /// 1) We use 32-bit integer division for (64-bit / 32-bit)
-///    if the dividend is < 2^32.
+///    if the dividend is < 2^32 and the CPU's 64-bit
+///    division is slow.
 /// 2) We use 64-bit integer division for (64-bit / 64-bit).
 /// 3) We use 64-bit integer division for (128-bit / 64-bit)
 ///    if the dividend is < 2^64.
@@ -62,6 +79,8 @@ template <typename X, typename Y>
 ALWAYS_INLINE typename std::enable_if<(sizeof(X) == sizeof(Y)), X>::type
 fast_div(X x, Y y)
 {
+  PROFILE_ADD(primecount::PROFILE_DIVISIONS, 1);
+
   // Unsigned integer division is usually
   // faster than signed integer division.
   using UX = typename std::make_unsigned<X>::type;
@@ -74,9 +93,14 @@ template <typename X, typename Y>
 ALWAYS_INLINE typename std::enable_if<(sizeof(X) > sizeof(Y)), X>::type
 fast_div(X x, Y y)
 {
+  PROFILE_ADD(primecount::PROFILE_DIVISIONS, 1);
+
   using smaller_t = typename make_smaller<X>::type;
 
-  if (x <= std::numeric_limits<smaller_t>::max())
+  // (128-bit / 64-bit) always benefits from
+  // using the smaller type if possible.
+  if ((primecount::is_div32 || sizeof(X) > sizeof(uint64_t)) &&
+      x <= std::numeric_limits<smaller_t>::max())
     return (smaller_t) x / (smaller_t) y;
   else
   {
@@ -118,6 +142,8 @@ ALWAYS_INLINE typename std::enable_if<(sizeof(X) >= sizeof(Y) &&
                                        sizeof(X) <= sizeof(uint64_t)), X>::type
 fast_div(X x, Y y)
 {
+  PROFILE_ADD(primecount::PROFILE_DIVISIONS, 1);
+
   // Unsigned integer division is usually
   // faster than signed integer division.
   using UX = typename std::make_unsigned<X>::type;
@@ -130,6 +156,8 @@ ALWAYS_INLINE typename std::enable_if<(sizeof(X) > sizeof(Y) &&
                                        sizeof(X) > sizeof(uint64_t)), X>::type
 fast_div(X x, Y y)
 {
+  PROFILE_ADD(primecount::PROFILE_DIVISIONS, 1);
+
   using smaller_t = typename make_smaller<X>::type;
 
   if (x <= std::numeric_limits<smaller_t>::max())
@@ -162,6 +190,7 @@ fast_div64(X x, Y y)
   // we use the unsigned division instruction further
   // down as DIV is usually faster than IDIV.
   ASSERT(x >= 0 && y > 0);
+  PROFILE_ADD(primecount::PROFILE_DIVISIONS, 1);
 
   uint64_t x0 = (uint64_t) x;
   uint64_t x1 = ((uint64_t*) &x)[1];
@@ -142,7 +142,7 @@ public:
       // phi(x / prime[i], i - 1) = 1 even if x / prime[i] > prime[i-1].
       // This works because in this case there is no other prime
       // inside the interval ]prime[i-1], x / prime[i]].
-      if_unlikely(primes_[i] > sqrtx)
+      if_unlikely((int64_t) primes_[i] > sqrtx)
         goto phi_1;
 
       int64_t xp = fast_div(x, primes_[i]);
@@ -163,7 +163,7 @@ public:
 
     for (; i <= a; i++)
     {
-      if_unlikely(primes_[i] > sqrtx)
+      if_unlikely((int64_t) primes_[i] > sqrtx)
         goto phi_1;
 
       // If a >= pi(sqrt(x)): phi(x, a) = pi(x) - a + 1
@@ -323,7 +323,7 @@ generate_phi(int64_t x,
     PhiCache<Primes> cache(x, a, primes, pi);
 
     // 2 <= i <= pi(sqrt(x)) + 1
-    for (; i <= a && primes[i - 1] <= sqrtx; i++)
+    for (; i <= a && (int64_t) primes[i - 1] <= sqrtx; i++)
       phi[i] = phi[i - 1] + cache.template phi<-1>(x / primes[i - 1], i - 2);
 
     // pi(sqrt(x)) + 1 < i <= a
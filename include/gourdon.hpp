@@ -10,12 +10,15 @@
 ///
 
 #include <int128_t.hpp>
+#include <pod_vector.hpp>
 #include <print.hpp>
 
 #include <stdint.h>
 
 namespace primecount {
 
+class PiTable;
+
 int64_t pi_gourdon(int64_t x, int threads);
 int64_t pi_gourdon_64(int64_t x, int threads, bool print = is_print());
 int64_t Sigma(int64_t x, int64_t y, int threads, bool print = is_print());
@@ -24,6 +27,12 @@ int64_t AC(int64_t x, int64_t y, int64_t z, int64_t k, int threads, bool print =
 int64_t B(int64_t x, int64_t y, int threads, bool print = is_print());
 int64_t D(int64_t x, int64_t y, int64_t z, int64_t k, int64_t d_approx, int threads, bool print = is_print());
 
+// When AC and D are computed concurrently in pi_gourdon(x) they
+// share the primes <= max(y, x_star^(1/2)) and the
+// PiTable(max(z, x_star^(1/2))).
+int64_t AC(int64_t x, int64_t y, int64_t z, int64_t k, const pod_vector<uint32_t>& primes, const PiTable& pi, int threads, bool print);
+int64_t D(int64_t x, int64_t y, int64_t z, int64_t k, int64_t d_approx, const pod_vector<uint32_t>& primes, const PiTable& pi, int threads, bool print);
+
 #ifdef HAVE_INT128_T
 
 int128_t pi_gourdon(int128_t x, int threads);
@@ -34,6 +43,11 @@ int128_t AC(int128_t x, int64_t y, int64_t z, int64_t k, int threads, bool print
 int128_t B(int128_t x, int64_t y, int threads, bool print = is_print());
 int128_t D(int128_t x, int64_t y, int64_t z, int64_t k, int128_t d_approx, int threads, bool print = is_print());
 
+int128_t AC(int128_t x, int64_t y, int64_t z, int64_t k, const pod_vector<uint32_t>& primes, const PiTable& pi, int threads, bool print);
+int128_t AC(int128_t x, int64_t y, int64_t z, int64_t k, const pod_vector<uint64_t>& primes, const PiTable& pi, int threads, bool print);
+int128_t D(int128_t x, int64_t y, int64_t z, int64_t k, int128_t d_approx, const pod_vector<uint32_t>& primes, const PiTable& pi, int threads, bool print);
+int128_t D(int128_t x, int64_t y, int64_t z, int64_t k, int128_t d_approx, const pod_vector<uint64_t>& primes, const PiTable& pi, int threads, bool print);
+
 #endif
 
 } // namespace
@@ -3,6 +3,12 @@
 /// @brief Functions to count the number of 1 bits inside
 ///        an array or a 64-bit word.
 ///
+///        If primecount has been compiled without POPCNT support
+///        on x86 (e.g. using cmake -DWITH_POPCNT=OFF to build a
+///        portable binary) we check at startup using CPUID if the
+///        CPU supports the POPCNT instruction and if so we use it,
+///        otherwise we use a portable bitwise algorithm.
+///
 /// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
 ///
 /// This file is distributed under the BSD License. See the COPYING
@@ -22,12 +28,73 @@
   #define __has_include(x) 0
 #endif
 
+// GCC & Clang x64 compiled without -mpopcnt
+#if defined(__x86_64__) && \
+   !defined(__POPCNT__) && \
+   (defined(__GNUC__) || defined(__clang__))
+  #define ENABLE_CPUID_POPCNT
+// MSVC x64 compiled without /arch:AVX
+#elif defined(_MSC_VER) && \
+      defined(_M_X64) && \
+     !defined(__AVX__)
+  #define ENABLE_CPUID_POPCNT
+#endif
+
+#if defined(ENABLE_CPUID_POPCNT)
+
+namespace primecount {
+
+/// Detected using CPUID in cpu_info.cpp
+extern const bool cpu_supports_popcnt;
+
+} // namespace
+
+namespace {
+
+/// Portable (bitwise) popcount algorithm:
+/// http://en.wikipedia.org/wiki/Hamming_weight#Efficient_implementation
+///
+inline uint64_t popcnt64_bitwise(uint64_t x)
+{
+  const uint64_t m1 = 0x5555555555555555ull;
+  const uint64_t m2 = 0x3333333333333333ull;
+  const uint64_t m4 = 0x0F0F0F0F0F0F0F0Full;
+  const uint64_t h01 = 0x0101010101010101ull;
+
+  x -= (x >> 1) & m1;
+  x = (x & m2) + ((x >> 2) & m2);
+  x = (x + (x >> 4)) & m4;
+  return (x * h01) >> 56;
+}
+
+} // namespace
+
+#endif
+
 // GCC & Clang
 #if defined(__GNUC__) || \
     __has_builtin(__builtin_popcountl)
 
 namespace {
 
+#if defined(ENABLE_CPUID_POPCNT)
+
+/// Without -mpopcnt __builtin_popcountll() would be compiled
+/// to a slow bitwise algorithm, hence we use inline assembly.
+///
+inline uint64_t popcnt64(uint64_t x)
+{
+  if (primecount::cpu_supports_popcnt)
+  {
+    __asm__ ("popcnt %1, %0" : "=r" (x) : "r" (x));
+    return x;
+  }
+  else
+    return popcnt64_bitwise(x);
+}
+
+#else
+
 inline uint64_t popcnt64(uint64_t x)
 {
 #if __cplusplus >= 201703L
@@ -42,6 +109,8 @@ inline uint64_t popcnt64(uint64_t x)
 #endif
 }
 
+#endif
+
 } // namespace
 
 #elif defined(_MSC_VER) && \
@@ -54,7 +123,14 @@ namespace {
 
 inline uint64_t popcnt64(uint64_t x)
 {
+#if defined(ENABLE_CPUID_POPCNT)
+  if (primecount::cpu_supports_popcnt)
+    return __popcnt64(x);
+  else
+    return popcnt64_bitwise(x);
+#else
   return __popcnt64(x);
+#endif
 }
 
 } // namespace
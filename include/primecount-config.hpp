@@ -27,6 +27,15 @@
   #define L2_CACHE_SIZE (512 << 10)
 #endif
 
+#ifndef LLC_CACHE_SIZE
+  /// Last level cache size in bytes (shared by all CPU cores).
+  /// Used to limit the memory usage of data structures that
+  /// are shared by all threads, e.g. the phi(x, a) cache.
+  /// For CPUs with multiple LLCs (e.g. AMD EPYC) pick the
+  /// size of one LLC.
+  #define LLC_CACHE_SIZE (32 << 20)
+#endif
+
 #ifndef MAX_CACHE_LINE_SIZE
   /// Maximum CPU cache line size in bytes (of all CPU types that
   /// will be produced over the next few decades).
@@ -19,6 +19,7 @@
 #include <algorithm>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace primecount {
 
@@ -35,11 +36,17 @@ int64_t pi_primesieve(int64_t x);
 std::string pi(const std::string& x, int threads);
 int64_t pi(int64_t x, int threads);
 int64_t pi_noprint(int64_t x, int threads);
+std::vector<int64_t> pi_batch(const std::vector<int64_t>& x, int threads);
+int64_t count_primes_sieve(int64_t low, int64_t high, int threads);
+bool is_sieve_gap(int64_t x1, int64_t x2);
 int64_t pi_deleglise_rivat(int64_t x, int threads);
 int64_t nth_prime(int64_t n, int threads);
+std::vector<int64_t> nth_prime_batch(const std::vector<int64_t>& n, int threads);
 
 int64_t pi_cache(int64_t x, bool print = is_print());
+int64_t count_primes(int64_t a, int64_t b, int threads, bool print = is_print());
 int64_t pi_deleglise_rivat_64(int64_t x, int threads, bool print = is_print());
+int64_t pi_from(int64_t x1, int64_t pi_x1, int64_t x2, int threads, bool print = is_print());
 int64_t pi_legendre(int64_t x, int threads, bool print = is_print());
 int64_t pi_lehmer(int64_t x, int threads, bool print = is_print());
 int64_t pi_lmo5(int64_t x, bool print = is_print());
@@ -57,6 +64,9 @@ int64_t Ri_inverse(int64_t);
 #ifdef HAVE_INT128_T
   int128_t pi(int128_t x);
   int128_t pi(int128_t x, int threads);
+  int128_t count_primes(int128_t a, int128_t b, int threads, bool print = is_print());
+  int128_t count_primes_sieve(int128_t low, int128_t high, int threads);
+  bool is_sieve_gap(int128_t x1, int128_t x2);
   int128_t pi_deleglise_rivat(int128_t x, int threads);
   int128_t pi_deleglise_rivat_128(int128_t x, int threads, bool print = is_print());
   int128_t P2(int128_t x, int64_t y, int64_t a, int threads, bool print = is_print());
@@ -67,6 +77,7 @@ int64_t Ri_inverse(int64_t);
   int128_t Ri_inverse(int128_t);
 #endif
 
+void print_cpu_info();
 void set_status_precision(int precision);
 int get_status_precision(maxint_t x);
 void set_alpha(double alpha);
@@ -78,7 +89,16 @@ double get_alpha_z(int64_t y, int64_t z);
 double get_alpha_lmo(maxint_t x);
 double get_alpha_deleglise_rivat(maxint_t x);
 std::pair<double, double> get_alpha_gourdon(maxint_t x);
+std::pair<int64_t, int64_t> get_yz_gourdon(maxint_t x);
+int64_t get_y_deleglise_rivat(maxint_t x);
 int64_t get_x_star_gourdon(maxint_t x, int64_t y);
+int64_t get_thread_memory(int threads);
+int64_t memory_usage_gourdon(maxint_t x, int64_t y, int64_t z, int threads, bool is_print);
+int64_t memory_usage_deleglise_rivat(maxint_t x, int64_t y, int threads);
+void fit_max_memory_gourdon(maxint_t x, int64_t& y, int64_t& z, int threads, bool is_print);
+void fit_max_memory_deleglise_rivat(maxint_t x, int64_t& y, int threads);
+void dry_run_gourdon(maxint_t x, int threads);
+void dry_run_deleglise_rivat(maxint_t x, int threads);
 maxint_t get_max_x(double alpha_y);
 maxint_t to_maxint(const std::string& expr);
 double get_time();
@@ -54,6 +54,40 @@ int64_t primecount_pi(int64_t x);
  */
 int primecount_pi_str(const char* x, char* res, size_t len);
 
+/*
+ * Count the number of primes inside the interval [a, b].
+ * If the interval is small compared to b the primes are
+ * counted using the segmented sieve of Eratosthenes, else
+ * pi(b) - pi(a - 1) is computed using the prime counting
+ * function.
+ * Returns -1 if an error occurs.
+ */
+int64_t primecount_count_primes(int64_t a, int64_t b);
+
+/*
+ * 128-bit version of primecount_count_primes(a, b).
+ * 
+ * @param a    Null-terminated string integer e.g. "12345".
+ * @param b    Null-terminated string integer, b must be
+ *             <= primecount_get_max_x().
+ * @param res  Result output buffer.
+ * @param len  Length of the res buffer, 32 is always enough.
+ * @return     Returns -1 if an error occurs, else returns the number
+ *             of characters (>= 1) that have been written to the
+ *             res buffer, not counting the terminating null character.
+ */
+int primecount_count_primes_str(const char* a, const char* b, char* res, size_t len);
+
+/*
+ * Count the number of primes <= x[i] for each of the len
+ * x values and store the results in res[i]. The primes
+ * inside the gaps between nearby x values are counted
+ * using the segmented sieve of Eratosthenes, this is much
+ * faster than calling primecount_pi(x) for each x.
+ * Returns -1 if an error occurs, else returns 0.
+ */
+int primecount_pi_batch(const int64_t* x, int64_t* res, size_t len);
+
 /*
  * Partial sieve function (a.k.a. Legendre-sum).
  * phi(x, a) counts the numbers <= x that are not divisible
@@ -73,6 +107,16 @@ int64_t primecount_phi(int64_t x, int64_t a);
  */
 int64_t primecount_nth_prime(int64_t n);
 
+/*
+ * Find the nth prime for each of the len n values and store
+ * the results in res[i]. The primes inside the gaps between
+ * nearby nth primes are counted using the segmented sieve of
+ * Eratosthenes, this is much faster than calling
+ * primecount_nth_prime(n) for each n.
+ * Returns -1 if an error occurs, else returns 0.
+ */
+int primecount_nth_prime_batch(const int64_t* n, int64_t* res, size_t len);
+
 /*
  * Largest number supported by primecount_pi_str(x).
  * @return 64-bit CPUs: 10^31,
@@ -88,6 +132,30 @@ int primecount_get_num_threads();
 /*  Set the number of threads */
 void primecount_set_num_threads(int num_threads);
 
+/*
+ * Get the currently set maximum memory usage in bytes.
+ * 0 means that there is no memory limit (default).
+ */
+size_t primecount_get_max_memory();
+
+/*
+ * Set the maximum memory usage in bytes (0 = no limit).
+ * primecount reduces the size of its lookup tables, caches
+ * and sieve arrays (at the cost of a longer run time) in
+ * order to stay below this limit. primecount_pi(x) returns
+ * -1 if the limit is too small.
+ */
+void primecount_set_max_memory(size_t bytes);
+
+/*
+ * Set the cache directory (NULL or "" = disabled).
+ * primecount stores the PiTable and the results of
+ * large pi(x), nth_prime(n) and phi(x, a) computations
+ * in this directory and reuses them in subsequent
+ * computations, also from other processes.
+ */
+void primecount_set_cache_dir(const char* dir);
+
 /* Get the primecount version number, in the form “i.j” */
 const char* primecount_version();
 
@@ -13,8 +13,10 @@
 #ifndef PRIMECOUNT_HPP
 #define PRIMECOUNT_HPP
 
+#include <cstddef>
 #include <stdexcept>
 #include <string>
+#include <vector>
 #include <stdint.h>
 
 #define PRIMECOUNT_VERSION "7.6"
@@ -54,6 +56,43 @@ int64_t pi(int64_t x);
 ///
 std::string pi(const std::string& x);
 
+/// Compute pi(x2) using the known value pi_x1 = pi(x1).
+/// If x2 is close to x1 the primes inside the gap between
+/// x1 and x2 are counted using the segmented sieve of
+/// Eratosthenes, else pi(x2) is computed from scratch.
+/// Throws a primecount_error if an error occurs.
+///
+int64_t pi_from(int64_t x1, int64_t pi_x1, int64_t x2);
+
+/// Count the number of primes inside the interval [a, b].
+/// If the interval is small compared to b the primes are
+/// counted using the segmented sieve of Eratosthenes,
+/// else we compute pi(b) - pi(a - 1) using the prime
+/// counting function. Uses all CPU cores by default.
+/// Throws a primecount_error if an error occurs.
+///
+int64_t count_primes(int64_t a, int64_t b);
+
+/// 128-bit version of count_primes(a, b).
+///
+/// @param a, b Null-terminated string integers e.g. "12345".
+///             Note that b must be <= get_max_x().
+/// Throws a primecount_error if an error occurs.
+///
+std::string count_primes(const std::string& a, const std::string& b);
+
+/// Count the number of primes <= x for each x in a list
+/// of x values. Instead of computing each pi(x) from
+/// scratch the x values are sorted and the primes inside
+/// the gaps between nearby x values are counted using the
+/// segmented sieve of Eratosthenes. This is much faster
+/// than calling pi(x) for each x if the gaps are small.
+/// Throws a primecount_error if an error occurs.
+///
+/// @return pi(x[i]) for each x[i] (in the same order).
+///
+std::vector<int64_t> pi_batch(const std::vector<int64_t>& x);
+
 /// Partial sieve function (a.k.a. Legendre-sum).
 /// phi(x, a) counts the numbers <= x that are not divisible
 /// by any of the first a primes.
@@ -71,6 +110,17 @@ int64_t phi(int64_t x, int64_t a);
 ///
 int64_t nth_prime(int64_t n);
 
+/// Find the nth prime for each n in a list of n values.
+/// Instead of computing each nth prime from scratch the
+/// n values are sorted and the primes inside the gaps
+/// between nearby nth primes are counted using the
+/// segmented sieve of Eratosthenes.
+/// Throws a primecount_error if an error occurs.
+///
+/// @return nth_prime(n[i]) for each n[i] (in the same order).
+///
+std::vector<int64_t> nth_prime_batch(const std::vector<int64_t>& n);
+
 /// Largest number supported by pi(const std::string& x).
 /// @return 64-bit CPUs: 10^31,
 ///         32-bit CPUs: 2^63-1.
@@ -85,6 +135,32 @@ int get_num_threads();
 /// Set the number of threads
 void set_num_threads(int num_threads);
 
+/// Get the currently set maximum memory usage in bytes.
+/// 0 means that there is no memory limit (default).
+///
+std::size_t get_max_memory();
+
+/// Set the maximum memory usage in bytes (0 = no limit).
+/// primecount reduces the size of its lookup tables, caches
+/// and sieve arrays (at the cost of a longer run time) in
+/// order to stay below this limit. pi(x) throws a
+/// primecount_error if the limit is too small.
+///
+void set_max_memory(std::size_t bytes);
+
+/// Get the currently set cache directory.
+/// An empty string means that caching is disabled (default).
+///
+std::string get_cache_dir();
+
+/// Set the cache directory (empty string = disabled).
+/// primecount stores the PiTable and the results of
+/// large pi(x), nth_prime(n) and phi(x, a) computations
+/// in this directory and reuses them in subsequent
+/// computations, also from other processes.
+///
+void set_cache_dir(const std::string& dir);
+
 /// Get the primecount version number, in the form “i.j”
 std::string primecount_version();
 
@@ -0,0 +1,103 @@
+///
+/// @file  profiling.hpp
+/// @brief Optional hot-path instrumentation, enabled using
+///        cmake -DWITH_PROFILING=ON. For each formula (S1,
+///        S2_trivial, S2_easy, S2_hard, P2, B, AC, D, Phi0 and
+///        Sigma) we count the special leaves, Sieve::count()
+///        calls, cross-off operations and divisions. On Linux
+///        we additionally read the CPU cycles, instructions and
+///        cache misses using perf_event_open(). A summary table
+///        is printed to stderr when the process exits.
+///
+///        By default (WITH_PROFILING=OFF) ProfileScope and
+///        PROFILE_ADD() are no-ops and do not generate any code.
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#ifndef PROFILING_HPP
+#define PROFILING_HPP
+
+#include <stdint.h>
+
+namespace primecount {
+
+enum ProfileCounter
+{
+  PROFILE_LEAVES,
+  PROFILE_SIEVE_COUNT,
+  PROFILE_CROSS_OFF,
+  PROFILE_DIVISIONS,
+  PROFILE_COUNTERS
+};
+
+#if defined(ENABLE_PROFILING)
+
+enum PerfEvent
+{
+  PERF_CYCLES,
+  PERF_INSTRUCTIONS,
+  PERF_CACHE_MISSES,
+  PERF_EVENTS
+};
+
+/// Each thread has its own counters so that counting
+/// does not require any synchronization.
+///
+struct ProfileThread
+{
+  ProfileThread();
+  ~ProfileThread();
+  ProfileThread(const ProfileThread&) = delete;
+  ProfileThread& operator=(const ProfileThread&) = delete;
+  uint64_t counters[PROFILE_COUNTERS] = { };
+  int perf_fds[PERF_EVENTS];
+};
+
+inline ProfileThread& profile_thread()
+{
+  thread_local ProfileThread thread;
+  return thread;
+}
+
+#define PROFILE_ADD(counter, n) \
+  (primecount::profile_thread().counters[counter] += (uint64_t) (n))
+
+/// Measures the formula's run time and counters. Only
+/// the outermost formula is profiled, nested computations
+/// e.g. pi(x / p) inside of B(x) are added to their
+/// parent formula.
+///
+class ProfileScope
+{
+public:
+  ProfileScope(const char* formula);
+  ~ProfileScope();
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+private:
+  const char* formula_;
+  bool is_owner_ = false;
+  double time_ = 0;
+  uint64_t counters_[PROFILE_COUNTERS] = { };
+  uint64_t perf_[PERF_EVENTS] = { };
+};
+
+#else
+
+#define PROFILE_ADD(counter, n) ((void) 0)
+
+class ProfileScope
+{
+public:
+  ProfileScope(const char*) { }
+};
+
+#endif
+
+} // namespace
+
+#endif
@@ -0,0 +1,71 @@
+///
+/// @file  progress.hpp
+/// @brief Machine-readable progress output. If enabled using
+///        --progress-fd=FD the formulas write their progress as
+///        JSON lines (one JSON object per line) to the file
+///        descriptor FD, e.g.:
+///
+///        {"event":"progress","formula":"D","percent":12.5,...}
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#ifndef PROGRESS_HPP
+#define PROGRESS_HPP
+
+#include <int128_t.hpp>
+
+#include <stdint.h>
+#include <string>
+
+namespace primecount {
+
+void set_progress_fd(int fd);
+bool is_progress();
+
+/// A single JSON object which is written as one
+/// line to the progress file descriptor.
+///
+class ProgressLine
+{
+public:
+  ProgressLine(const std::string& event, const std::string& formula);
+  ProgressLine& add_int(const std::string& key, maxint_t value);
+  ProgressLine& add_double(const std::string& key, double value);
+  void write() const;
+private:
+  std::string json_;
+};
+
+/// Each formula that reports its progress creates a Progress
+/// object. Like the Backup class only the outermost
+/// computation reports its progress, nested computations
+/// with a different x, e.g. pi(low) inside of P2(x), are
+/// never reported.
+///
+class Progress
+{
+public:
+  Progress(const std::string& formula, maxint_t x);
+  ~Progress();
+  Progress(const Progress&) = delete;
+  Progress& operator=(const Progress&) = delete;
+  bool is_enabled() const { return is_enabled_; }
+  bool is_due();
+  double remaining_secs(double percent) const;
+  ProgressLine line(const std::string& event) const;
+
+private:
+  std::string formula_;
+  double start_time_ = 0;
+  double time_ = 0;
+  bool is_enabled_ = false;
+  bool is_owner_ = false;
+};
+
+} // namespace
+
+#endif
@@ -24,14 +24,16 @@
 namespace primecount {
 
 /// We need to sieve [sqrt(x), sieve_limit[
-LoadBalancerP2::LoadBalancerP2(maxint_t x,
+LoadBalancerP2::LoadBalancerP2(const std::string& formula,
+                               maxint_t x,
                                int64_t sieve_limit,
                                int threads,
                                bool is_print) :
   low_(isqrt(x)),
   sieve_limit_(sieve_limit),
   precision_(get_status_precision(x)),
-  is_print_(is_print)
+  is_print_(is_print),
+  progress_(formula, x)
 {
   low_ = min(low_, sieve_limit_);
   int64_t dist = sieve_limit_ - low_;
@@ -78,13 +80,12 @@ bool LoadBalancerP2::get_work(int64_t& low, int64_t& high)
   else
   {
     // Ensure that the thread initialization, i.e. the
-    // computation of PrimePi(low), uses at most 10%
-    // of the entire thread computation.
-    // Since PrimePi(low) uses O(low^(2/3)/log(low)^2) time,
-    // sieving a distance of n = low^(2/3) * 5 uses
-    // O(n log log n) time, which is more than 10x more.
-    double low13 = std::cbrt(low_);
-    int64_t n = (int64_t) (low13 * low13 * 5);
+    // generation of the sieving primes <= sqrt(high) by
+    // primesieve::iterator, uses only a small fraction
+    // of the thread computation.
+    // The threads do not compute PrimePi(low) anymore,
+    // see finish_work().
+    int64_t n = isqrt(low_) * 100;
     min_thread_dist_ = std::max(min_thread_dist_, n);
     thread_dist_ = max(min_thread_dist_, thread_dist_);
 
@@ -103,6 +104,47 @@ bool LoadBalancerP2::get_work(int64_t& low, int64_t& high)
   return low < sieve_limit_;
 }
 
+/// Each thread computes pi(x / prime) - pi(low - 1) for
+/// the leaves of its chunk [low, high[. The thread reports
+/// its number of leaves and the number of primes inside
+/// [low, high[ so that we can later add the missing
+/// leaves * pi(low - 1) without computing pi(low - 1)
+/// for each chunk.
+///
+void LoadBalancerP2::finish_work(int64_t low,
+                                 int64_t leaves,
+                                 int64_t count)
+{
+  LockGuard lockGuard(lock_);
+  chunks_.push_back(Chunk{low, leaves, count});
+}
+
+/// Returns the sum of leaves * pi(low - 1) of all chunks.
+/// Must be called after all threads have finished. The
+/// chunks are contiguous, hence pi(low - 1) of each chunk
+/// is pi(low - 1) of the previous chunk + its count.
+/// pi(low - 1) is only computed for the first chunk.
+///
+maxint_t LoadBalancerP2::get_pi_low_sum()
+{
+  if (chunks_.empty())
+    return 0;
+
+  std::sort(chunks_.begin(), chunks_.end(),
+    [](const Chunk& a, const Chunk& b) { return a.low < b.low; });
+
+  maxint_t sum = 0;
+  int64_t pi_low = pi_noprint(chunks_[0].low - 1, threads_);
+
+  for (const Chunk& chunk : chunks_)
+  {
+    sum += (maxint_t) chunk.leaves * pi_low;
+    pi_low += chunk.count;
+  }
+
+  return sum;
+}
+
 void LoadBalancerP2::print_status()
 {
   if (is_print_)
@@ -118,6 +160,19 @@ void LoadBalancerP2::print_status()
                 << get_percent(low_, sieve_limit_) << '%' << std::flush;
     }
   }
+
+  // --progress-fd JSON output, the thread
+  // distance is used as segment size.
+  if (progress_.is_due())
+  {
+    double percent = get_percent(low_, sieve_limit_);
+
+    progress_.line("progress")
+      .add_double("percent", percent)
+      .add_double("remaining_secs", progress_.remaining_secs(percent))
+      .add_int("segment_size", thread_dist_)
+      .write();
+  }
 }
 
 } // namespace
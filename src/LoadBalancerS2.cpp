@@ -22,6 +22,27 @@
 ///        order to prevent that 1 thread will run much longer
 ///        than all the other threads.
 ///
+///        By default the threads claim their next interval using
+///        compare and swap, the load balancing is only updated
+///        by the thread that currently holds the lock. Hence the
+///        threads never queue up on the lock, even when using
+///        hundreds of threads.
+///
+///        If backups are enabled the LoadBalancerS2 regularly
+///        stores its current state in the backup file. Since
+///        the threads finish their intervals out of order we
+///        store the next unassigned low, the sum of all finished
+///        intervals and all intervals that are still being
+///        sieved. When resuming, the unfinished intervals are
+///        assigned to the threads first.
+///
+///        In distributed mode (--shard=i/N) only the i-th part
+///        of the sieving interval is assigned to the threads.
+///
+///        With --progress-fd the LoadBalancerS2 reports its
+///        progress and the statistics of each finished thread
+///        work item as JSON lines (see progress.cpp).
+///
 /// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
 ///
 /// This file is distributed under the BSD License. See the COPYING
@@ -29,6 +50,8 @@
 ///
 
 #include <LoadBalancerS2.hpp>
+#include <backup.hpp>
+#include <primecount.hpp>
 #include <primecount-config.hpp>
 #include <primecount-internal.hpp>
 #include <StatusS2.hpp>
@@ -36,23 +59,41 @@
 #include <imath.hpp>
 #include <int128_t.hpp>
 #include <min.hpp>
+#include <print.hpp>
+#include <to_string.hpp>
 
 #include <stdint.h>
+#include <algorithm>
+#include <cstddef>
+#include <sstream>
+#include <string>
 
 namespace primecount {
 
-LoadBalancerS2::LoadBalancerS2(maxint_t x,
+LoadBalancerS2::LoadBalancerS2(const std::string& formula,
+                               maxint_t x,
                                int64_t sieve_limit,
                                maxint_t sum_approx,
                                int threads,
                                bool is_print) :
+  low_(0),
+  work_(0),
   sieve_limit_(sieve_limit),
   sum_approx_(sum_approx),
   time_(get_time()),
   is_print_(is_print),
-  status_(x)
+  status_(x),
+  progress_(formula, x),
+  formula_(formula)
 {
   lock_.init(threads);
+  print_lock_.init(threads);
+  backup_lock_.init(threads);
+
+  auto shard = get_shard_range(x, sieve_limit);
+  shard_low_ = shard.first;
+  shard_high_ = shard.second;
+  low_ = shard_low_;
 
   // The best performance is usually achieved using
   // a sieve array size that matches your CPU's L1
@@ -60,7 +101,10 @@ LoadBalancerS2::LoadBalancerS2(maxint_t x,
   // larger than your L1 cache size but smaller than
   // your L2 cache size (per core). Also, the
   // segment_size must be >= sqrt(sieve_limit).
+  // If the user has set a memory limit the sieve
+  // array size may also be smaller.
   int64_t sieve_bytes = L1D_CACHE_SIZE * 2;
+  sieve_bytes = min(sieve_bytes, get_thread_memory(threads));
   int64_t numbers_per_byte = 30;
   int64_t sqrt_limit = isqrt(sieve_limit);
   max_size_ = max(sieve_bytes * numbers_per_byte, sqrt_limit);
@@ -88,6 +132,7 @@ LoadBalancerS2::LoadBalancerS2(maxint_t x,
   int64_t min_size = 1 << 9;
   segment_size_ = max(min_size, segment_size_);
   segment_size_ = Sieve::get_segment_size(segment_size_);
+  publish_work();
 }
 
 maxint_t LoadBalancerS2::get_sum() const
@@ -95,33 +140,358 @@ maxint_t LoadBalancerS2::get_sum() const
   return sum_;
 }
 
-bool LoadBalancerS2::get_work(ThreadData& thread)
+/// Restore the state of a previously interrupted computation
+/// from the backup file. Afterwards the state of the
+/// LoadBalancerS2 is regularly stored in the backup file.
+///
+void LoadBalancerS2::resume(Backup& backup)
 {
-  LockGuard lockGuard(lock_);
-  sum_ += thread.sum;
+  if (!backup.is_enabled())
+    return;
+
+  backup_ = &backup;
+  backup_time_ = get_time();
+
+  int64_t sieve_limit = 0;
+  int64_t low = 0;
+  std::string pending;
+
+  // The backup belongs to a different computation
+  if (!backup.get(formula_ + ".sieve_limit", sieve_limit) ||
+      sieve_limit != sieve_limit_)
+    return;
+
+  if (!backup.get(formula_ + ".low", low) ||
+      !backup.get(formula_ + ".max_low", max_low_) ||
+      !backup.get(formula_ + ".segments", segments_) ||
+      !backup.get(formula_ + ".segment_size", segment_size_) ||
+      !backup.get(formula_ + ".sum", sum_))
+    throw primecount_error("corrupt backup file: " + get_backup_file());
+
+  low_ = low;
+  publish_work();
+
+  // Unfinished intervals: "low:segments:segment_size, ..."
+  if (backup.get(formula_ + ".pending", pending))
+  {
+    std::replace(pending.begin(), pending.end(), ':', ' ');
+    std::replace(pending.begin(), pending.end(), ',', ' ');
+    std::istringstream iss(pending);
+    Interval interval;
+
+    while (iss >> interval.low >> interval.segments >> interval.segment_size)
+      pending_.push_back(interval);
+  }
 
   if (is_print_)
   {
-    uint64_t dist = thread.segments * thread.segment_size;
-    uint64_t high = thread.low + dist;
-    status_.print(high, sieve_limit_, sum_, sum_approx_);
+    std::string msg = "Resuming " + formula_ + "(x) from low = " + std::to_string(low);
+    print(msg.c_str());
+  }
+}
+
+/// Store a snapshot of the LoadBalancerS2's state in the
+/// backup file. Multiple threads may concurrently write
+/// backups, we make sure an older snapshot never
+/// overwrites a newer one.
+///
+void LoadBalancerS2::backup(const Snapshot& snapshot)
+{
+  LockGuard lockGuard(backup_lock_);
+
+  if (snapshot.id <= backup_id_)
+    return;
+
+  backup_id_ = snapshot.id;
+  std::ostringstream pending;
+
+  for (const auto& interval : snapshot.pending)
+    pending << interval.low << ':' << interval.segments << ':' << interval.segment_size << ", ";
+
+  std::map<std::string, std::string> values;
+  values[formula_ + ".sieve_limit"] = std::to_string(sieve_limit_);
+  values[formula_ + ".low"] = std::to_string(snapshot.low);
+  values[formula_ + ".max_low"] = std::to_string(snapshot.max_low);
+  values[formula_ + ".segments"] = std::to_string(snapshot.segments);
+  values[formula_ + ".segment_size"] = std::to_string(snapshot.segment_size);
+  values[formula_ + ".sum"] = to_string(snapshot.sum);
+  values[formula_ + ".pending"] = pending.str();
+  backup_->set(values);
+}
+
+/// Printing is slow, hence it is done outside of the
+/// load balancer's lock. If another thread is currently
+/// printing we simply skip this status update.
+///
+void LoadBalancerS2::print_status(int64_t high, maxint_t sum)
+{
+  TryLockGuard tryLockGuard(print_lock_);
+
+  if (tryLockGuard.owns_lock())
+    status_.print(high, shard_high_ - shard_low_, sum, sum_approx_);
+}
+
+/// Write the progress and the statistics of the thread's
+/// finished work item as JSON lines. If another thread is
+/// currently writing we skip this progress update, but the
+/// thread statistics are always written.
+///
+void LoadBalancerS2::print_progress(const ProgressData& data)
+{
+  if (data.thread.segments > 0)
+  {
+    progress_.line("thread")
+      .add_int("thread", omp_get_thread_num())
+      .add_int("low", data.thread.low)
+      .add_int("segments", data.thread.segments)
+      .add_int("segment_size", data.thread.segment_size)
+      .add_double("init_secs", data.thread.init_secs)
+      .add_double("secs", data.thread.secs)
+      .write();
   }
 
-  update_load_balancing(thread);
+  TryLockGuard tryLockGuard(print_lock_);
 
-  thread.low = low_;
-  thread.segments = segments_;
-  thread.segment_size = segment_size_;
+  if (tryLockGuard.owns_lock() &&
+      progress_.is_due())
+  {
+    double percent = status_.getPercent(data.high, shard_high_ - shard_low_, data.sum, sum_approx_);
+
+    progress_.line("progress")
+      .add_double("percent", percent)
+      .add_double("remaining_secs", data.remaining_secs)
+      .add_int("segments", data.segments)
+      .add_int("segment_size", data.segment_size)
+      .add_int("sum", data.sum)
+      .write();
+  }
+}
+
+bool LoadBalancerS2::get_work(ThreadData& thread)
+{
+  // Backups and the thread statistics of --progress-fd
+  // need a consistent view of all intervals.
+  if (backup_ || progress_.is_enabled())
+    return get_work_locked(thread);
+  else
+    return get_work_lockfree(thread);
+}
+
+/// The threads claim their next interval using compare and
+/// swap on low_, hence no thread ever waits for another
+/// thread. Only the thread that acquires lock_ adds its sum
+/// to sum_ and updates the load balancing. If lock_ is held
+/// by another thread this is skipped and the thread's sum
+/// is added the next time it acquires lock_.
+///
+bool LoadBalancerS2::get_work_lockfree(ThreadData& thread)
+{
+  int64_t high = thread.low + thread.segments * thread.segment_size - shard_low_;
+  high = max(high, 0);
+  thread.unreported_sum += thread.sum;
   thread.sum = 0;
+  maxint_t sum = 0;
+  bool is_status = false;
+
+  {
+    TryLockGuard tryLockGuard(lock_);
+
+    if (tryLockGuard.owns_lock())
+    {
+      sum_ += thread.unreported_sum;
+      sum = sum_;
+      thread.unreported_sum = 0;
+      is_status = is_print_;
+      update_load_balancing(thread);
+      publish_work();
+    }
+  }
+
   thread.secs = 0;
   thread.init_secs = 0;
+  uint64_t work = work_.load(std::memory_order_relaxed);
+  int64_t low = low_.load(std::memory_order_relaxed);
 
-  low_ += segments_ * segment_size_;
-  bool is_work = thread.low < sieve_limit_;
+  // On failure compare_exchange_weak() updates low
+  do
+  {
+    thread.low = low;
+    thread.segments = (int64_t) (work >> 32);
+    thread.segment_size = (int64_t) (work & 0xffffffff);
+    fit_shard(thread);
+
+    if (thread.low >= shard_high_)
+      break;
+  }
+  while (!low_.compare_exchange_weak(low, low + thread.segments * thread.segment_size,
+                                     std::memory_order_relaxed));
+
+  bool is_work = thread.low < shard_high_;
+
+  // The thread is finished, add its remaining sum
+  if (!is_work &&
+      thread.unreported_sum != 0)
+  {
+    LockGuard lockGuard(lock_);
+    sum_ += thread.unreported_sum;
+    thread.unreported_sum = 0;
+  }
+
+  if (is_status)
+    print_status(high, sum);
 
   return is_work;
 }
 
+bool LoadBalancerS2::get_work_locked(ThreadData& thread)
+{
+  int64_t high = thread.low + thread.segments * thread.segment_size - shard_low_;
+  high = max(high, 0);
+  maxint_t sum = 0;
+  bool is_backup = false;
+  bool is_work = false;
+  bool is_progress = progress_.is_enabled();
+  Snapshot snapshot;
+  ProgressData progress;
+
+  // Only the load balancing itself is done inside the
+  // critical section. Printing the status and writing
+  // the backup file (which are slow) is done afterwards
+  // in order to prevent the threads from queuing up
+  // on the lock.
+  {
+    LockGuard lockGuard(lock_);
+    sum_ += thread.sum;
+    sum = sum_;
+
+    // The thread has finished sieving its interval
+    if (backup_ && thread.segments > 0)
+      finished(thread.low);
+
+    update_load_balancing(thread);
+
+    if (is_progress)
+    {
+      progress.thread = thread;
+      progress.high = high;
+      progress.sum = sum;
+    }
+
+    thread.sum = 0;
+    thread.secs = 0;
+    thread.init_secs = 0;
+
+    // First assign the unfinished intervals
+    // of a resumed computation.
+    if (!pending_.empty())
+    {
+      Interval interval = pending_.back();
+      pending_.pop_back();
+      thread.low = interval.low;
+      thread.segments = interval.segments;
+      thread.segment_size = interval.segment_size;
+    }
+    else
+    {
+      thread.low = low_;
+      thread.segments = segments_;
+      thread.segment_size = segment_size_;
+
+      fit_shard(thread);
+      low_ += thread.segments * thread.segment_size;
+    }
+
+    is_work = thread.low < shard_high_;
+
+    if (is_progress)
+    {
+      progress.segments = segments_;
+      progress.segment_size = segment_size_;
+      progress.remaining_secs = remaining_secs();
+    }
+
+    if (backup_)
+    {
+      if (is_work)
+        in_flight_.push_back(Interval{thread.low, thread.segments, thread.segment_size});
+
+      if (get_time() - backup_time_ >= get_backup_interval())
+      {
+        is_backup = true;
+        backup_time_ = get_time();
+        snapshot.id = ++snapshot_id_;
+        snapshot.low = low_;
+        snapshot.max_low = max_low_;
+        snapshot.segments = segments_;
+        snapshot.segment_size = segment_size_;
+        snapshot.sum = sum_;
+        snapshot.pending = pending_;
+        snapshot.pending.insert(snapshot.pending.end(), in_flight_.begin(), in_flight_.end());
+      }
+    }
+  }
+
+  if (is_print_)
+    print_status(high, sum);
+  if (is_progress)
+    print_progress(progress);
+  if (is_backup)
+    backup(snapshot);
+
+  return is_work;
+}
+
+/// The interval must not cross the end of the
+/// shard, the shard's end is a multiple of 240.
+///
+void LoadBalancerS2::fit_shard(ThreadData& thread) const
+{
+  if (shard_high_ < sieve_limit_)
+  {
+    int64_t dist = shard_high_ - thread.low;
+
+    if (thread.segments * thread.segment_size > dist)
+    {
+      if (dist >= thread.segment_size)
+        thread.segments = dist / thread.segment_size;
+      else if (dist > 0)
+      {
+        thread.segments = 1;
+        thread.segment_size = dist;
+      }
+    }
+  }
+}
+
+/// Store segments_ and segment_size_ in a single atomic
+/// variable which is read by get_work_lockfree().
+/// segment_size_ <= max(L1 cache size * 60, sqrt(sieve_limit))
+/// always fits into 32 bits.
+///
+void LoadBalancerS2::publish_work()
+{
+  ASSERT(segment_size_ <= 0xffffffffll);
+  uint64_t segments = (uint64_t) min(segments_, 0xffffffffll);
+  uint64_t segment_size = (uint64_t) segment_size_;
+  work_.store((segments << 32) | segment_size, std::memory_order_relaxed);
+}
+
+/// Remove the interval starting at low
+/// from the intervals being sieved.
+///
+void LoadBalancerS2::finished(int64_t low)
+{
+  for (std::size_t i = 0; i < in_flight_.size(); i++)
+  {
+    if (in_flight_[i].low == low)
+    {
+      in_flight_[i] = in_flight_.back();
+      in_flight_.pop_back();
+      return;
+    }
+  }
+}
+
 void LoadBalancerS2::update_load_balancing(const ThreadData& thread)
 {
   if (thread.low > max_low_)
@@ -239,7 +609,7 @@ void LoadBalancerS2::update_number_of_segments(const ThreadData& thread)
 /// Remaining seconds till finished
 double LoadBalancerS2::remaining_secs() const
 {
-  double percent = status_.getPercent(low_, sieve_limit_, sum_, sum_approx_);
+  double percent = status_.getPercent(low_ - shard_low_, shard_high_ - shard_low_, sum_, sum_approx_);
   percent = in_between(10, percent, 100);
   double total_secs = get_time() - time_;
   double secs = total_secs * (100 / percent) - total_secs;
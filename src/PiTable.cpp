@@ -15,6 +15,7 @@
 ///
 
 #include <PiTable.hpp>
+#include <primecount.hpp>
 #include <primecount-internal.hpp>
 #include <primesieve.hpp>
 #include <pod_vector.hpp>
@@ -76,15 +77,39 @@ const pod_array<PiTable::pi_t, 64> PiTable::pi_cache_ =
 PiTable::PiTable(uint64_t max_x, int threads) :
   max_x_(max_x)
 {
-  // Initialize PiTable from cache
   uint64_t limit = max_x + 1;
+  uint64_t cache_limit = pi_cache_.size() * 240;
+  bool is_file_cache = limit > cache_limit && !get_cache_dir().empty();
+
+  // Reuse a previously computed PiTable
+  if (is_file_cache)
+  {
+    file_ = PiTableFile::load(max_x);
+    if (file_)
+    {
+      static_assert(sizeof(pi_t) == sizeof(uint64_t) * 2, "Invalid pi_t size!");
+      pi_data_ = (const pi_t*) file_->data();
+      return;
+    }
+
+    // In order to reduce the number of cache file
+    // updates we compute a slightly larger PiTable
+    // (up to 25% larger) than requested.
+    uint64_t round = next_power_of_2(limit) / 8;
+    limit = ceil_div(limit, round) * round;
+  }
+
+  // Initialize PiTable from cache
   pi_.resize(ceil_div(limit, 240));
   std::size_t n = min(pi_cache_.size(), pi_.size());
   std::copy_n(&pi_cache_[0], n, &pi_[0]);
+  pi_data_ = pi_.data();
 
-  uint64_t cache_limit = pi_cache_.size() * 240;
   if (limit > cache_limit)
     init(limit, cache_limit, threads);
+
+  if (is_file_cache)
+    PiTableFile::store((const uint64_t*) pi_.data(), limit - 1);
 }
 
 /// Used if PiTable larger than pi_cache
@@ -0,0 +1,284 @@
+///
+/// @file  PiTableCache.cpp
+/// @brief Optional on-disk cache for the PiTable.
+///
+///        File format (64-bit integers in native byte order):
+///        magic, version, max_x, entries, checksum
+///        followed by entries * { count, bits }.
+///
+///        The cache file is replaced atomically (write to a
+///        temporary file and rename) hence processes that have
+///        memory mapped the previous cache file are not affected.
+///        Errors while writing the cache file are ignored as the
+///        cache is only a performance optimization.
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <PiTableCache.hpp>
+#include <primecount.hpp>
+#include <imath.hpp>
+#include <pod_vector.hpp>
+
+#include <stdint.h>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+  #define HAVE_MMAP
+#elif defined(_WIN32)
+  #include <process.h>
+#endif
+
+namespace {
+
+using namespace primecount;
+
+// "PCPITAB1" in little endian
+const uint64_t magic = 0x3142415449504350ull;
+// Increase whenever the file format changes
+const uint64_t version = 1;
+const std::size_t header_words = 5;
+
+// cache_dir_ and cached_ must only be
+// accessed while holding mutex_.
+std::string cache_dir_;
+std::mutex mutex_;
+std::shared_ptr<const PiTableFile> cached_;
+
+/// mutex_ must be held by the caller
+std::string cache_file()
+{
+  return cache_dir_ + "/primecount-pitable.bin";
+}
+
+uint64_t checksum(const uint64_t* data, uint64_t words)
+{
+  uint64_t hash = 0xcbf29ce484222325ull;
+
+  for (uint64_t i = 0; i < words; i++)
+  {
+    hash ^= data[i];
+    hash *= 0x100000001b3ull;
+    hash ^= hash >> 29;
+  }
+
+  return hash;
+}
+
+uint64_t get_entries(uint64_t max_x)
+{
+  return ceil_div(max_x + 1, 240);
+}
+
+/// Returns true if the header and the data are valid
+bool is_valid(const uint64_t* header, std::size_t file_size)
+{
+  if (file_size < header_words * sizeof(uint64_t) ||
+      header[0] != magic ||
+      header[1] != version ||
+      header[3] != get_entries(header[2]))
+    return false;
+
+  uint64_t words = header[3] * 2;
+  uint64_t expected = (header_words + words) * sizeof(uint64_t);
+  if (file_size != expected)
+    return false;
+
+  return checksum(header + header_words, words) == header[4];
+}
+
+/// Returns max_x of the cache file or 0 if
+/// there is no (valid) cache file.
+///
+uint64_t read_max_x(const std::string& filename)
+{
+  uint64_t header[header_words] = { 0 };
+  std::ifstream file(filename, std::ios::binary);
+
+  if (!file.read((char*) header, sizeof(header)) ||
+      header[0] != magic ||
+      header[1] != version)
+    return 0;
+
+  return header[2];
+}
+
+int get_pid()
+{
+#if defined(HAVE_MMAP)
+  return (int) getpid();
+#elif defined(_WIN32)
+  return (int) _getpid();
+#else
+  return 0;
+#endif
+}
+
+} // namespace
+
+namespace primecount {
+
+void set_cache_dir(const std::string& dir)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  cache_dir_ = dir;
+  cached_.reset();
+}
+
+std::string get_cache_dir()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return cache_dir_;
+}
+
+std::string PiTableFile::filename()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return cache_file();
+}
+
+PiTableFile::~PiTableFile()
+{
+#if defined(HAVE_MMAP)
+  if (map_)
+    munmap(map_, map_size_);
+#endif
+}
+
+/// Returns a PiTableFile with max_x >= the requested
+/// max_x or nullptr if there is no such file.
+///
+std::shared_ptr<const PiTableFile> PiTableFile::load(uint64_t max_x)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (cache_dir_.empty())
+    return nullptr;
+  if (cached_ && cached_->max_x() >= max_x)
+    return cached_;
+
+  // Another process may have stored a larger PiTable
+  std::string file = cache_file();
+  if (read_max_x(file) < max_x)
+    return nullptr;
+
+  auto pi_file = open(file);
+  if (pi_file && pi_file->max_x() >= max_x)
+  {
+    cached_ = pi_file;
+    return cached_;
+  }
+
+  return nullptr;
+}
+
+std::shared_ptr<const PiTableFile> PiTableFile::open(const std::string& filename)
+{
+  std::shared_ptr<PiTableFile> pi_file(new PiTableFile());
+  const uint64_t* header = nullptr;
+  std::size_t file_size = 0;
+
+#if defined(HAVE_MMAP)
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return nullptr;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0)
+  {
+    close(fd);
+    return nullptr;
+  }
+
+  file_size = (std::size_t) st.st_size;
+  void* map = mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (map == MAP_FAILED)
+    return nullptr;
+
+  pi_file->map_ = map;
+  pi_file->map_size_ = file_size;
+  header = (const uint64_t*) map;
+#else
+  std::ifstream file(filename, std::ios::binary | std::ios::ate);
+  if (!file)
+    return nullptr;
+
+  file_size = (std::size_t) file.tellg();
+  if (file_size % sizeof(uint64_t))
+    return nullptr;
+
+  pi_file->buffer_.resize(file_size / sizeof(uint64_t));
+  file.seekg(0);
+  if (!file.read((char*) pi_file->buffer_.data(), file_size))
+    return nullptr;
+
+  header = pi_file->buffer_.data();
+#endif
+
+  if (!is_valid(header, file_size))
+    return nullptr;
+
+  pi_file->max_x_ = header[2];
+  pi_file->data_ = header + header_words;
+
+  return pi_file;
+}
+
+/// Store the PiTable in the cache directory if it is
+/// larger than the currently cached PiTable.
+///
+void PiTableFile::store(const uint64_t* data, uint64_t max_x)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (cache_dir_.empty())
+    return;
+  if (cached_ && cached_->max_x() >= max_x)
+    return;
+
+  std::string file = cache_file();
+  if (read_max_x(file) >= max_x)
+    return;
+
+  uint64_t entries = get_entries(max_x);
+  uint64_t words = entries * 2;
+  uint64_t header[header_words] = { magic, version, max_x, entries, checksum(data, words) };
+  std::string tmp_file = file + ".tmp" + std::to_string(get_pid());
+
+  {
+    std::ofstream out(tmp_file, std::ios::binary | std::ios::trunc);
+    out.write((const char*) header, sizeof(header));
+    out.write((const char*) data, words * sizeof(uint64_t));
+
+    if (!out)
+    {
+      out.close();
+      std::remove(tmp_file.c_str());
+      return;
+    }
+  }
+
+#if defined(_WIN32)
+  // On Windows std::rename() fails if the file exists
+  std::remove(file.c_str());
+#endif
+
+  if (std::rename(tmp_file.c_str(), file.c_str()) != 0)
+    std::remove(tmp_file.c_str());
+}
+
+} // namespace
@@ -0,0 +1,243 @@
+///
+/// @file  ResultCache.cpp
+/// @brief Optional persistent cache for the results of pi(x),
+///        nth_prime(n) and phi(x, a).
+///
+///        The results are stored in an append-only text file
+///        with one result per line:
+///        version key = value;
+///        e.g. "7.6 pi(1000000000000) = 37607912018;". Each line
+///        is appended using a single write, lines from other
+///        primecount versions and incomplete lines (without the
+///        trailing ';', e.g. because the process was killed) are
+///        ignored. An in-process LRU cache of the most recently
+///        used results sits in front of the cache file.
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <ResultCache.hpp>
+#include <primecount.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+
+/// Max number of results in the in-process LRU cache
+const std::size_t max_lru_size = 1024;
+
+using lru_list_t = std::list<std::pair<std::string, std::string>>;
+
+std::mutex mutex_;
+std::string dir_;
+lru_list_t lru_;
+std::unordered_map<std::string, lru_list_t::iterator> lru_map_;
+
+// Size of the part of the cache file that
+// has already been loaded into the LRU cache.
+std::streamoff file_pos_ = 0;
+
+// True once a result has been evicted from the LRU
+// cache, afterwards a lookup that misses the LRU cache
+// must search the part of the file that has already
+// been loaded.
+bool is_evicted_ = false;
+
+std::string filename()
+{
+  return dir_ + "/primecount-results.txt";
+}
+
+bool is_number(const std::string& str)
+{
+  if (str.empty())
+    return false;
+
+  for (char c : str)
+    if (c < '0' || c > '9')
+      return false;
+
+  return true;
+}
+
+void lru_insert(const std::string& key, const std::string& value)
+{
+  auto iter = lru_map_.find(key);
+  if (iter != lru_map_.end())
+  {
+    lru_.erase(iter->second);
+    lru_map_.erase(iter);
+  }
+
+  lru_.emplace_front(key, value);
+  lru_map_[key] = lru_.begin();
+
+  if (lru_.size() > max_lru_size)
+  {
+    lru_map_.erase(lru_.back().first);
+    lru_.pop_back();
+    is_evicted_ = true;
+  }
+}
+
+bool lru_find(const std::string& key, std::string& value)
+{
+  auto iter = lru_map_.find(key);
+  if (iter == lru_map_.end())
+    return false;
+
+  // Move to the front, i.e. most recently used
+  lru_.splice(lru_.begin(), lru_, iter->second);
+  value = iter->second->second;
+  return true;
+}
+
+/// The in-process LRU cache belongs to the
+/// current cache directory.
+///
+bool is_enabled()
+{
+  std::string dir = primecount::get_cache_dir();
+
+  if (dir != dir_)
+  {
+    dir_ = dir;
+    lru_.clear();
+    lru_map_.clear();
+    file_pos_ = 0;
+    is_evicted_ = false;
+  }
+
+  return !dir_.empty();
+}
+
+/// Parse a line of the cache file: "version key = value;"
+bool parse_line(std::string& line,
+                std::string& key,
+                std::string& value)
+{
+  std::string prefix = std::string(PRIMECOUNT_VERSION) + " ";
+
+  if (!line.empty() && line.back() == '\r')
+    line.pop_back();
+
+  std::size_t pos = line.find(" = ");
+
+  if (pos == std::string::npos ||
+      pos <= prefix.size() ||
+      line.back() != ';' ||
+      line.compare(0, prefix.size(), prefix) != 0)
+    return false;
+
+  key = line.substr(prefix.size(), pos - prefix.size());
+  value = line.substr(pos + 3, line.size() - pos - 4);
+  return is_number(value);
+}
+
+/// Search the cache file for the key. The lines that have
+/// been appended to the cache file (e.g. by other processes)
+/// since the last call are added to the LRU cache. The part
+/// of the file that has already been loaded is only searched
+/// again if results have been evicted from the LRU cache.
+/// If a key occurs multiple times the last value is used.
+///
+bool read_file(const std::string& key, std::string& value)
+{
+  std::ifstream file(filename(), std::ios::binary | std::ios::ate);
+  if (!file)
+    return false;
+
+  // The cache file has been deleted or replaced
+  if (file.tellg() < file_pos_)
+  {
+    file_pos_ = 0;
+    is_evicted_ = false;
+  }
+
+  std::streamoff pos = is_evicted_ ? 0 : file_pos_;
+  file.seekg(pos);
+
+  std::string line;
+  std::string line_key;
+  std::string line_value;
+  bool found = false;
+
+  // The last line is only loaded once it
+  // has been terminated by a newline.
+  while (std::getline(file, line) && !file.eof())
+  {
+    bool is_new = pos >= file_pos_;
+    pos += line.size() + 1;
+
+    if (parse_line(line, line_key, line_value))
+    {
+      if (is_new)
+        lru_insert(line_key, line_value);
+      if (line_key == key)
+      {
+        value = line_value;
+        found = true;
+      }
+    }
+  }
+
+  file_pos_ = std::max(file_pos_, pos);
+
+  if (found)
+    lru_insert(key, value);
+
+  return found;
+}
+
+} // namespace
+
+namespace primecount {
+
+bool get_cached_result(const std::string& key, std::string& value)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (!is_enabled())
+    return false;
+
+  return lru_find(key, value) ||
+         read_file(key, value);
+}
+
+/// Append the result to the cache file. Errors are
+/// ignored as the cache is only an optimization.
+///
+void set_cached_result(const std::string& key, const std::string& value)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (!is_enabled())
+    return;
+
+  lru_insert(key, value);
+  std::string line = std::string(PRIMECOUNT_VERSION) + " " + key + " = " + value + ";\n";
+
+  // Terminate a previous incomplete line
+  std::ifstream in(filename(), std::ios::binary | std::ios::ate);
+  if (in && in.tellg() > 0)
+  {
+    in.seekg(-1, std::ios::end);
+    if (in.get() != '\n')
+      line = "\n" + line;
+  }
+
+  std::ofstream file(filename(), std::ios::app);
+  file.write(line.data(), line.size());
+}
+
+} // namespace
@@ -20,6 +20,7 @@
 #include <int128_t.hpp>
 #include <pod_vector.hpp>
 #include <print.hpp>
+#include <profiling.hpp>
 #include <S.hpp>
 
 #include <stdint.h>
@@ -51,6 +52,8 @@ T S1_thread(T x,
     T next = square_free * primes[b];
     if (next > y) break;
     s1 += MU * phi_tiny(x / next, c);
+    PROFILE_ADD(PROFILE_LEAVES, 1);
+    PROFILE_ADD(PROFILE_DIVISIONS, 1);
     s1 += S1_thread<-MU>(x, y, b, c, next, primes);
   }
 
@@ -80,6 +83,8 @@ X S1_OpenMP(X x,
   for (int64_t b = c + 1; b <= pi_y; b++)
   {
     s1 -= phi_tiny(x / primes[b], c);
+    PROFILE_ADD(PROFILE_LEAVES, 1);
+    PROFILE_ADD(PROFILE_DIVISIONS, 1);
     s1 += S1_thread<1>(x, y, b, c, (X) primes[b], primes);
   }
 
@@ -96,6 +101,7 @@ int64_t S1(int64_t x,
            int threads,
            bool is_print)
 {
+  ProfileScope profile("S1");
   double time;
 
   if (is_print)
@@ -122,6 +128,7 @@ int128_t S1(int128_t x,
             int threads,
             bool is_print)
 {
+  ProfileScope profile("S1");
   double time;
 
   if (is_print)
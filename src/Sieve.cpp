@@ -36,14 +36,22 @@
 
 #include <Sieve.hpp>
 #include <SieveTables.hpp>
+#include <cpuid.hpp>
 #include <imath.hpp>
 #include <macros.hpp>
 #include <min.hpp>
 #include <pod_vector.hpp>
 #include <popcnt.hpp>
+#include <profiling.hpp>
 
 #include <stdint.h>
 #include <algorithm>
+#include <cmath>
+
+#if defined(ENABLE_MULTIARCH_AVX512_VPOPCNT) || \
+    defined(ENABLE_MULTIARCH_AVX2)
+  #include <immintrin.h>
+#endif
 
 using std::fill_n;
 using std::sqrt;
@@ -51,6 +59,11 @@ using primecount::pod_array;
 
 namespace {
 
+/// The two-level counter is only used if count(stop)
+/// skips over at least this many counter array elements
+/// per coarse counter array element.
+const double min_counter_ratio = 8;
+
 struct WheelInit
 {
   uint8_t factor;
@@ -82,6 +95,111 @@ const pod_array<WheelInit, 30> wheel_init
   {4,  7}, {3,  7}, {2,  7}, {1,  7}, {0,  7}
 }};
 
+/// Count the 1 bits of data[0, size[ using the POPCNT
+/// instruction (portable default algorithm).
+///
+uint64_t popcnt_default(const uint64_t* data, uint64_t size)
+{
+  uint64_t cnt = 0;
+  for (uint64_t i = 0; i < size; i++)
+    cnt += popcnt64(data[i]);
+  return cnt;
+}
+
+#if defined(ENABLE_MULTIARCH_AVX512_VPOPCNT)
+
+/// Count the 1 bits of data[0, size[ using the AVX512
+/// VPOPCNTQ instruction which counts 8 words at once.
+/// The remaining words are counted using a masked load
+/// hence there is no scalar loop.
+///
+__attribute__ ((target ("avx512f,avx512vpopcntdq")))
+uint64_t popcnt_avx512(const uint64_t* data, uint64_t size)
+{
+  __m512i vcnt = _mm512_setzero_si512();
+  uint64_t i = 0;
+
+  for (; i + 8 <= size; i += 8)
+  {
+    __m512i vec = _mm512_loadu_si512(&data[i]);
+    vcnt = _mm512_add_epi64(vcnt, _mm512_popcnt_epi64(vec));
+  }
+
+  if (i < size)
+  {
+    __mmask8 mask = (__mmask8) (0xff >> (i + 8 - size));
+    __m512i vec = _mm512_maskz_loadu_epi64(mask, &data[i]);
+    vcnt = _mm512_add_epi64(vcnt, _mm512_popcnt_epi64(vec));
+  }
+
+  return _mm512_reduce_add_epi64(vcnt);
+}
+
+const bool is_avx512_vpopcnt = primecount::has_cpuid_avx512_vpopcnt();
+
+#endif
+
+#if defined(ENABLE_MULTIARCH_AVX2)
+
+/// Count the 1 bits of data[0, size[ using AVX2. The bits
+/// of each nibble are counted using a 16 entries lookup
+/// table (vpshufb) and the byte counts are summed up
+/// using vpsadbw. Algorithm by Wojciech Mula:
+/// https://arxiv.org/abs/1611.07612
+///
+__attribute__ ((target ("avx2,popcnt")))
+uint64_t popcnt_avx2(const uint64_t* data, uint64_t size)
+{
+  const __m256i lookup = _mm256_setr_epi8(
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_mask = _mm256_set1_epi8(0x0f);
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i vcnt = zero;
+  uint64_t i = 0;
+
+  for (; i + 4 <= size; i += 4)
+  {
+    __m256i vec = _mm256_loadu_si256((const __m256i*) &data[i]);
+    __m256i lo = _mm256_and_si256(vec, low_mask);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(vec, 4), low_mask);
+    __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo),
+                                  _mm256_shuffle_epi8(lookup, hi));
+    vcnt = _mm256_add_epi64(vcnt, _mm256_sad_epu8(cnt, zero));
+  }
+
+  uint64_t cnt = (uint64_t) _mm256_extract_epi64(vcnt, 0) +
+                 (uint64_t) _mm256_extract_epi64(vcnt, 1) +
+                 (uint64_t) _mm256_extract_epi64(vcnt, 2) +
+                 (uint64_t) _mm256_extract_epi64(vcnt, 3);
+
+  for (; i < size; i++)
+    cnt += (uint64_t) __builtin_popcountll(data[i]);
+
+  return cnt;
+}
+
+const bool is_avx2 = primecount::has_cpuid_avx2();
+
+#endif
+
+/// Count the 1 bits of data[0, size[ using the
+/// fastest algorithm supported by the CPU.
+///
+uint64_t popcnt(const uint64_t* data, uint64_t size)
+{
+#if defined(ENABLE_MULTIARCH_AVX512_VPOPCNT)
+  if (is_avx512_vpopcnt)
+    return popcnt_avx512(data, size);
+#endif
+#if defined(ENABLE_MULTIARCH_AVX2)
+  if (is_avx2)
+    return popcnt_avx2(data, size);
+#endif
+
+  return popcnt_default(data, size);
+}
+
 } // namespace
 
 namespace primecount {
@@ -102,7 +220,10 @@ Sieve::Sieve(uint64_t low,
   sieve_.resize(segment_size / 30);
   wheel_.reserve(wheel_size);
   wheel_.resize(4);
-  allocate_counter(low);
+
+  // Initially we estimate the average distance between
+  // consecutive leaves, afterwards we measure it.
+  allocate_counter(sqrt(low));
 }
 
 /// Each element of the counter array contains the current
@@ -114,11 +235,10 @@ Sieve::Sieve(uint64_t low,
 /// whilst sieving as the distance between consecutive
 /// leaves is very small ~ log(x) at the beginning of the
 /// sieving algorithm but grows up to segment_size towards
-/// the end of the algorithm.
+/// the end of the algorithm, see update_counter().
 ///
-void Sieve::allocate_counter(uint64_t low)
+void Sieve::allocate_counter(double average_leaf_dist)
 {
-  double average_leaf_dist = sqrt(low);
   double counter_dist = sqrt(average_leaf_dist);
 
   // Here we balance counting with the counter array and
@@ -150,6 +270,28 @@ void Sieve::allocate_counter(uint64_t low)
   counter_.counter.resize(counter_size);
   counter_.dist = bytes * 30;
   counter_.log2_dist = ilog2(bytes);
+
+  // If the leaves are sparse count(stop) needs to iterate
+  // over many counter array elements. In this case we
+  // additionally use a coarse counter array where each
+  // element contains the sum of ratio counter array
+  // elements. The cost of count(stop) is then
+  // average_leaf_dist / (counter_.dist * ratio) + ratio,
+  // which is minimized for ratio = sqrt(leaf_dist / dist).
+  uint64_t blocks_ratio = (uint64_t) sqrt(average_leaf_dist / counter_.dist);
+  blocks_ratio = min(blocks_ratio, counter_size);
+
+  if (blocks_ratio >= min_counter_ratio)
+  {
+    blocks_ratio = next_power_of_2(blocks_ratio);
+    counter_.log2_ratio = ilog2(blocks_ratio);
+    counter_.blocks.resize(ceil_div(counter_size, blocks_ratio));
+  }
+  else
+  {
+    counter_.log2_ratio = 0;
+    counter_.blocks.clear();
+  }
 }
 
 /// The segment size is sieve.size() * 30 as each
@@ -160,6 +302,50 @@ uint64_t Sieve::segment_size() const
   return sieve_.size() * 30;
 }
 
+/// Returns the name of the popcnt() algorithm
+/// used by count(), for primecount --cpu-info.
+///
+const char* Sieve::get_count_kernel()
+{
+#if defined(ENABLE_MULTIARCH_AVX512_VPOPCNT)
+  if (is_avx512_vpopcnt)
+    return "AVX512 VPOPCNT";
+#endif
+#if defined(ENABLE_MULTIARCH_AVX2)
+  if (is_avx2)
+    return "AVX2";
+#endif
+
+  return "popcnt64()";
+}
+
+/// The popcnt() kernels are public so that the
+/// tests can check each kernel the CPU supports,
+/// not only the one picked by the dispatcher.
+///
+uint64_t Sieve::popcnt_default(const uint64_t* data, uint64_t size)
+{
+  return ::popcnt_default(data, size);
+}
+
+#if defined(ENABLE_MULTIARCH_AVX512_VPOPCNT)
+
+uint64_t Sieve::popcnt_avx512(const uint64_t* data, uint64_t size)
+{
+  return ::popcnt_avx512(data, size);
+}
+
+#endif
+
+#if defined(ENABLE_MULTIARCH_AVX2)
+
+uint64_t Sieve::popcnt_avx2(const uint64_t* data, uint64_t size)
+{
+  return ::popcnt_avx2(data, size);
+}
+
+#endif
+
 /// segment_size must be a multiple of 240 as we
 /// process 64-bit words (8 bytes) and each
 /// byte contains 30 numbers.
@@ -191,6 +377,7 @@ void Sieve::reset_sieve(uint64_t low, uint64_t high)
 
 void Sieve::reset_counter()
 {
+  leaf_dist_ += prev_stop_;
   prev_stop_ = 0;
   count_ = 0;
   counter_.i = 0;
@@ -198,25 +385,55 @@ void Sieve::reset_counter()
   counter_.stop = counter_.dist;
 }
 
-void Sieve::init_counter(uint64_t low, uint64_t high)
+/// Measure the average distance between consecutive leaves
+/// in the previous segment and adjust the counter distance
+/// accordingly. For each sieving prime the leaves are
+/// counted in ascending order using count(stop), hence
+/// the distance covered by count(stop) is the stop number
+/// of the last leaf (see reset_counter()).
+///
+void Sieve::update_counter()
+{
+  leaf_dist_ += prev_stop_;
+  prev_stop_ = 0;
+
+  if (leaves_ > 0)
+  {
+    double average_leaf_dist = (double) leaf_dist_ / (double) leaves_;
+    allocate_counter(average_leaf_dist);
+  }
+
+  leaves_ = 0;
+  leaf_dist_ = 0;
+}
+
+void Sieve::init_counter()
 {
+  update_counter();
   reset_counter();
   total_count_ = 0;
 
-  uint64_t start = 0;
-  uint64_t max_stop = (high - 1) - low;
+  // reset_sieve() has unset the bits >= high, hence we can
+  // count the unsieved elements of each counter interval
+  // without bit masks. Since counter_.dist is a multiple of
+  // 240 (64-bit word) each counter interval corresponds to
+  // a block of words that are counted in bulk.
+  auto sieve64 = (const uint64_t*) sieve_.data();
+  uint64_t words = sieve_.size() / sizeof(uint64_t);
+  uint64_t dist = counter_.dist / 240;
 
-  while (start <= max_stop)
+  for (uint64_t i = 0, j = 0; j < words; i++, j += dist)
   {
-    uint64_t stop = start + counter_.dist - 1;
-    stop = min(stop, max_stop);
-    uint64_t cnt = count(start, stop);
-    uint64_t byte_index = start / 30;
-    uint64_t i = byte_index >> counter_.log2_dist;
-
+    uint64_t cnt = popcnt(&sieve64[j], min(dist, words - j));
     counter_[i] = (uint32_t) cnt;
     total_count_ += cnt;
-    start += counter_.dist;
+  }
+
+  if (!counter_.blocks.empty())
+  {
+    fill_n(counter_.blocks.data(), counter_.blocks.size(), 0);
+    for (std::size_t i = 0; i < counter_.counter.size(); i++)
+      counter_.blocks[i >> counter_.log2_ratio] += counter_[i];
   }
 }
 
@@ -226,6 +443,8 @@ uint64_t Sieve::count(uint64_t stop)
   ASSERT(stop >= prev_stop_);
   uint64_t start = prev_stop_ + 1;
   prev_stop_ = stop;
+  leaves_++;
+  PROFILE_ADD(PROFILE_SIEVE_COUNT, 1);
 
   // Quickly count the number of unsieved elements (in
   // the sieve array) up to a value that is close to
@@ -234,6 +453,31 @@ uint64_t Sieve::count(uint64_t stop)
   // of the counter array contains the number of
   // unsieved elements in the interval:
   // [i * counter_.dist, (i + 1) * counter_.dist[.
+  if (!counter_.blocks.empty())
+  {
+    // Move to the start of the next block
+    uint64_t ratio = 1ull << counter_.log2_ratio;
+    while (counter_.stop <= stop && (counter_.i & (ratio - 1)))
+    {
+      start = counter_.stop;
+      counter_.stop += counter_.dist;
+      counter_.sum += counter_[counter_.i++];
+      count_ = counter_.sum;
+    }
+
+    // Skip over whole blocks, each block corresponds
+    // to ratio elements of the counter array.
+    uint64_t block_dist = counter_.dist << counter_.log2_ratio;
+    while (counter_.stop - counter_.dist + block_dist <= stop)
+    {
+      counter_.stop += block_dist;
+      start = counter_.stop - counter_.dist;
+      counter_.sum += counter_.blocks[counter_.i >> counter_.log2_ratio];
+      counter_.i += ratio;
+      count_ = counter_.sum;
+    }
+  }
+
   while (counter_.stop <= stop)
   {
     start = counter_.stop;
@@ -269,8 +513,7 @@ uint64_t Sieve::count(uint64_t start, uint64_t stop) const
   else
   {
     uint64_t cnt = popcnt64(sieve64[start_idx] & m1);
-    for (uint64_t i = start_idx + 1; i < stop_idx; i++)
-      cnt += popcnt64(sieve64[i]);
+    cnt += popcnt(&sieve64[start_idx + 1], stop_idx - (start_idx + 1));
     cnt += popcnt64(sieve64[stop_idx] & m2);
     return cnt;
   }
@@ -305,15 +548,30 @@ void Sieve::add(uint64_t prime)
 /// from the sieve array. Used for pre-sieving.
 ///
 void Sieve::cross_off(uint64_t prime, uint64_t i)
+{
+  cross_off(prime, i, 0, sieve_.size());
+}
+
+/// Remove the i-th prime and the multiples of the i-th prime
+/// from the block sieve[start, start + size[. The multiple
+/// of the wheel is relative to the start of the block.
+///
+void Sieve::cross_off(uint64_t prime,
+                      uint64_t i,
+                      uint64_t start,
+                      uint64_t size)
 {
   if (i >= wheel_.size())
     add(prime);
 
+  // Each byte of the sieve array corresponds to
+  // 30 numbers of which 8 are coprime to 30.
+  PROFILE_ADD(PROFILE_CROSS_OFF, size * 8 / prime);
   prime /= 30;
   Wheel& wheel = wheel_[i];
   uint64_t m = wheel.multiple;
-  uint8_t* sieve = sieve_.data();
-  uint64_t sieve_size = sieve_.size();
+  uint8_t* sieve = &sieve_[start];
+  uint64_t sieve_size = size;
 
   #define CHECK_FINISHED(wheel_index) \
     if_unlikely(m >= sieve_size) \
@@ -561,6 +819,20 @@ void Sieve::cross_off(uint64_t prime, uint64_t i)
 /// whose least prime factor is the i-th prime.
 ///
 void Sieve::cross_off_count(uint64_t prime, uint64_t i)
+{
+  PROFILE_ADD(PROFILE_CROSS_OFF, sieve_.size() * 8 / prime);
+
+  if (counter_.blocks.empty())
+    cross_off_count<false>(prime, i);
+  else
+    cross_off_count<true>(prime, i);
+}
+
+/// If TWO_LEVEL_COUNTER = true the coarse counter
+/// array (counter_.blocks) is updated as well.
+///
+template <bool TWO_LEVEL_COUNTER>
+void Sieve::cross_off_count(uint64_t prime, uint64_t i)
 {
   if (i >= wheel_.size())
     add(prime);
@@ -572,8 +844,10 @@ void Sieve::cross_off_count(uint64_t prime, uint64_t i)
   uint64_t m = wheel.multiple;
   uint64_t total_count = total_count_;
   uint64_t counter_log2_dist = counter_.log2_dist;
+  uint64_t blocks_log2_dist = counter_.log2_dist + counter_.log2_ratio;
   uint64_t sieve_size = sieve_.size();
   uint32_t* counter = &counter_[0];
+  uint32_t* blocks = counter_.blocks.data();
   uint8_t* sieve = &sieve_[0];
 
   #define CHECK_FINISHED(wheel_index) \
@@ -591,6 +865,8 @@ void Sieve::cross_off_count(uint64_t prime, uint64_t i)
       std::size_t is_bit = (sieve_byte >> bit_index) & 1; \
       sieve[m] &= ~(1 << bit_index); \
       counter[m >> counter_log2_dist] -= (uint32_t) is_bit; \
+      if (TWO_LEVEL_COUNTER) \
+        blocks[m >> blocks_log2_dist] -= (uint32_t) is_bit; \
       total_count -= (uint64_t) is_bit; \
     }
 
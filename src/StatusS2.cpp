@@ -60,16 +60,20 @@ StatusS2::StatusS2(maxint_t x)
 }
 
 /// This method is used by S2_hard() and D().
-/// This method does not use a lock to synchronize threads
-/// as it is only used inside of a critical section inside
-/// LoadBalancerS2.cpp and hence it can never be accessed
-/// simultaneously from multiple threads.
+/// This method is thread-safe as it does not
+/// modify any member variables.
 ///
 double StatusS2::getPercent(int64_t low, int64_t limit, maxint_t sum, maxint_t sum_approx)
 {
-  double p1 = skewed_percent(sum, sum_approx);
   double p2 = skewed_percent(low, limit);
 
+  // sum_approx is unknown if the formula is computed
+  // concurrently with the formulas it depends on.
+  if (sum_approx <= 0)
+    return p2;
+
+  double p1 = skewed_percent(sum, sum_approx);
+
   // When p2 is larger then p1 it is
   // always much more accurate.
   if (p2 > p1)
@@ -85,6 +89,12 @@ double StatusS2::getPercent(int64_t low, int64_t limit, maxint_t sum, maxint_t s
   return percent;
 }
 
+/// This method is used by S2_easy().
+double StatusS2::getPercent(int64_t b, int64_t max_b)
+{
+  return skewed_percent(b, max_b);
+}
+
 void StatusS2::print(double percent)
 {
   double old = percent_;
@@ -99,9 +109,9 @@ void StatusS2::print(double percent)
 
 /// This method is used by S2_hard() and D().
 /// This method does not use a lock to synchronize threads
-/// as it is only used inside of a critical section inside
-/// LoadBalancerS2.cpp and hence it can never be accessed
-/// simultaneously from multiple threads.
+/// as it is only called by the thread holding the
+/// print_lock_ of LoadBalancerS2 and hence it can never
+/// be accessed simultaneously from multiple threads.
 ///
 void StatusS2::print(int64_t low, int64_t limit, maxint_t sum, maxint_t sum_approx)
 {
@@ -128,7 +138,7 @@ void StatusS2::print(int64_t b, int64_t max_b)
   if ((time - old) >= threshold_)
   {
     time_ = time;
-    double percent = skewed_percent(b, max_b);
+    double percent = getPercent(b, max_b);
     print(percent);
   }
 }
@@ -15,9 +15,11 @@
 #include <int128_t.hpp>
 #include <PiTable.hpp>
 #include <print.hpp>
+#include <ResultCache.hpp>
 #include <to_string.hpp>
 
 #include <cmath>
+#include <cstddef>
 #include <limits>
 #include <string>
 #include <stdint.h>
@@ -28,10 +30,27 @@
 
 namespace {
 
+using namespace primecount;
+
 #ifdef _OPENMP
   int threads_ = 0;
 #endif
 
+// 0 = no memory limit
+std::size_t max_memory_ = 0;
+
+/// All public pi(x) functions store their results
+/// in the result cache (if enabled).
+///
+template <typename T, typename F>
+T pi_cached(T x, F compute)
+{
+  if (x < min_cached_x)
+    return compute();
+
+  return cached_result<T>("pi(" + to_string((maxint_t) x) + ")", compute);
+}
+
 } // namespace
 
 namespace primecount {
@@ -69,7 +88,7 @@ int64_t pi(int64_t x, int threads)
     return pi_meissel(x, threads);
 
   // For large x Gourdon's algorithm runs fastest
-  return pi_gourdon_64(x, threads);
+  return pi_cached(x, [&] { return pi_gourdon_64(x, threads); });
 }
 
 /// Used internally for initialization
@@ -100,7 +119,7 @@ int128_t pi(int128_t x, int threads)
   if (x <= std::numeric_limits<int64_t>::max())
     return pi((int64_t) x, threads);
 
-  return pi_gourdon_128(x, threads);
+  return pi_cached(x, [&] { return pi_gourdon_128(x, threads); });
 }
 
 #endif
@@ -117,14 +136,27 @@ std::string pi(const std::string& x, int threads)
   return to_string(res);
 }
 
+int64_t count_primes(int64_t a, int64_t b)
+{
+  return count_primes(a, b, get_num_threads());
+}
+
+std::string count_primes(const std::string& a, const std::string& b)
+{
+  maxint_t n1 = to_maxint(a);
+  maxint_t n2 = to_maxint(b);
+  maxint_t res = count_primes(n1, n2, get_num_threads());
+  return to_string(res);
+}
+
 int64_t pi_deleglise_rivat(int64_t x, int threads)
 {
-  return pi_deleglise_rivat_64(x, threads);
+  return pi_cached(x, [&] { return pi_deleglise_rivat_64(x, threads); });
 }
 
 int64_t pi_gourdon(int64_t x, int threads)
 {
-  return pi_gourdon_64(x, threads);
+  return pi_cached(x, [&] { return pi_gourdon_64(x, threads); });
 }
 
 #ifdef HAVE_INT128_T
@@ -133,9 +165,9 @@ int128_t pi_deleglise_rivat(int128_t x, int threads)
 {
   // use 64-bit if possible
   if (x <= std::numeric_limits<int64_t>::max())
-    return pi_deleglise_rivat_64((int64_t) x, threads);
+    return pi_deleglise_rivat((int64_t) x, threads);
   else
-    return pi_deleglise_rivat_128(x, threads);
+    return pi_cached(x, [&] { return pi_deleglise_rivat_128(x, threads); });
 }
 
 int128_t pi_gourdon(int128_t x, int threads)
@@ -144,7 +176,7 @@ int128_t pi_gourdon(int128_t x, int threads)
   if (x <= std::numeric_limits<int64_t>::max())
     return pi_gourdon_64((int64_t) x, threads);
   else
-    return pi_gourdon_128(x, threads);
+    return pi_cached(x, [&] { return pi_gourdon_128(x, threads); });
 }
 
 #endif
@@ -212,4 +244,14 @@ void set_num_threads(int threads)
   primesieve::set_num_threads(threads);
 }
 
+std::size_t get_max_memory()
+{
+  return max_memory_;
+}
+
+void set_max_memory(std::size_t bytes)
+{
+  max_memory_ = bytes;
+}
+
 } // namespace
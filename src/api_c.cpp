@@ -14,8 +14,10 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <algorithm>
 #include <sstream>
 #include <string>
+#include <vector>
 #include <exception>
 #include <iostream>
 
@@ -71,6 +73,78 @@ int primecount_pi_str(const char* x, char* res, size_t len)
   }
 }
 
+int64_t primecount_count_primes(int64_t a, int64_t b)
+{
+  try
+  {
+    return primecount::count_primes(a, b);
+  }
+  catch(const std::exception& e)
+  {
+    std::cerr << "primecount_count_primes: " << e.what() << std::endl;
+    return -1;
+  }
+}
+
+int primecount_count_primes_str(const char* a, const char* b, char* res, size_t len)
+{
+  try
+  {
+    if (!a || !b)
+      throw primecount::primecount_error("a and b must not be NULL pointers");
+
+    if (!res)
+      throw primecount::primecount_error("res must not be a NULL pointer");
+
+    std::string count = primecount::count_primes(std::string(a), std::string(b));
+
+    // +1 required to add null at the end of the string
+    if (len < count.length() + 1)
+    {
+      std::ostringstream oss;
+      oss << "res buffer too small, res.len = " << len << " < required = " << count.length() + 1;
+      throw primecount::primecount_error(oss.str());
+    }
+
+    count.copy(res, count.length());
+    res[count.length()] = '\0';
+
+    return (int) count.length();
+  }
+  catch(const std::exception& e)
+  {
+    std::cerr << "primecount_count_primes_str: " << e.what() << std::endl;
+
+    if (res && len > 0)
+      res[0] = '\0';
+
+    return -1;
+  }
+}
+
+int primecount_pi_batch(const int64_t* x, int64_t* res, size_t len)
+{
+  try
+  {
+    if (len > 0 && !x)
+      throw primecount::primecount_error("x must not be a NULL pointer");
+
+    if (len > 0 && !res)
+      throw primecount::primecount_error("res must not be a NULL pointer");
+
+    std::vector<int64_t> xs(x, x + len);
+    std::vector<int64_t> pix = primecount::pi_batch(xs);
+    std::copy(pix.begin(), pix.end(), res);
+
+    return 0;
+  }
+  catch(const std::exception& e)
+  {
+    std::cerr << "primecount_pi_batch: " << e.what() << std::endl;
+    return -1;
+  }
+}
+
 int64_t primecount_nth_prime(int64_t n)
 {
   try
@@ -84,6 +158,29 @@ int64_t primecount_nth_prime(int64_t n)
   }
 }
 
+int primecount_nth_prime_batch(const int64_t* n, int64_t* res, size_t len)
+{
+  try
+  {
+    if (len > 0 && !n)
+      throw primecount::primecount_error("n must not be a NULL pointer");
+
+    if (len > 0 && !res)
+      throw primecount::primecount_error("res must not be a NULL pointer");
+
+    std::vector<int64_t> ns(n, n + len);
+    std::vector<int64_t> primes = primecount::nth_prime_batch(ns);
+    std::copy(primes.begin(), primes.end(), res);
+
+    return 0;
+  }
+  catch(const std::exception& e)
+  {
+    std::cerr << "primecount_nth_prime_batch: " << e.what() << std::endl;
+    return -1;
+  }
+}
+
 int64_t primecount_phi(int64_t x, int64_t a)
 {
   try
@@ -122,6 +219,21 @@ void primecount_set_num_threads(int threads)
   }
 }
 
+size_t primecount_get_max_memory()
+{
+  return primecount::get_max_memory();
+}
+
+void primecount_set_max_memory(size_t bytes)
+{
+  primecount::set_max_memory(bytes);
+}
+
+void primecount_set_cache_dir(const char* dir)
+{
+  primecount::set_cache_dir(dir ? dir : "");
+}
+
 const char* primecount_get_max_x()
 {
 #ifdef HAVE_INT128_T
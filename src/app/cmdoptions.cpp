@@ -11,14 +11,17 @@
 
 #include "cmdoptions.hpp"
 
+#include <backup.hpp>
 #include <primecount.hpp>
 #include <primecount-internal.hpp>
 #include <pod_vector.hpp>
 #include <print.hpp>
+#include <progress.hpp>
 #include <int128_t.hpp>
 
 #include <stdint.h>
 #include <cstddef>
+#include <cstdlib>
 #include <map>
 #include <string>
 #include <type_traits>
@@ -96,6 +99,151 @@ void optionStatus(Option& opt,
     set_status_precision(opt.to<int>());
 }
 
+/// Default backup file name
+const std::string backup_file = "primecount.backup";
+
+void optionBackup(Option& opt)
+{
+  if (opt.val.empty())
+    set_backup_file(backup_file);
+  else
+    set_backup_file(opt.val);
+}
+
+void optionCpuInfo()
+{
+  print_cpu_info();
+  std::exit(0);
+}
+
+/// Parse --max-memory=SIZE, e.g. --max-memory=8G.
+/// Supported suffixes: K, M, G, T (powers of 1024),
+/// optionally followed by "B" or "iB".
+///
+void optionMaxMemory(Option& opt)
+{
+  std::string str = opt.val;
+  std::size_t pos = str.find_first_not_of("0123456789");
+  std::string number = str.substr(0, pos);
+  std::string suffix;
+
+  if (pos != std::string::npos)
+    suffix = str.substr(pos);
+
+  const std::map<std::string, int> shifts =
+  {
+    { "", 0 }, { "B", 0 },
+    { "K", 10 }, { "KB", 10 }, { "KiB", 10 },
+    { "M", 20 }, { "MB", 20 }, { "MiB", 20 },
+    { "G", 30 }, { "GB", 30 }, { "GiB", 30 },
+    { "T", 40 }, { "TB", 40 }, { "TiB", 40 }
+  };
+
+  if (number.empty() ||
+      number.size() > 12 ||
+      !shifts.count(suffix))
+    throw primecount_error("invalid option '" + opt.str + "', expected --max-memory=SIZE e.g. 8G");
+
+  uint64_t bytes = std::stoull(number) << shifts.at(suffix);
+  uint64_t max_bytes = 1ull << 62;
+
+  if (bytes > max_bytes ||
+      (bytes >> shifts.at(suffix)) != std::stoull(number))
+    throw primecount_error("invalid option '" + opt.str + "', memory size too large");
+
+  set_max_memory((std::size_t) bytes);
+}
+
+/// --progress-fd=FD: write the progress of
+/// the computation as JSON lines to FD.
+///
+void optionProgressFd(Option& opt)
+{
+  int fd = opt.to<int>();
+  if (fd < 0)
+    throw primecount_error("invalid option '" + opt.str + "', FD must be >= 0");
+
+  set_progress_fd(fd);
+}
+
+/// Parse --from=x1:pi(x1), used to compute
+/// pi(x) from a known pi(x1).
+///
+void optionFrom(Option& opt,
+                CmdOptions& opts)
+{
+  std::size_t pos = opt.val.find(':');
+  if (pos == std::string::npos)
+    throw primecount_error("invalid option '" + opt.str + "', expected --from=x1:pi");
+
+  try {
+    opts.from_x = (int64_t) to_maxint(opt.val.substr(0, pos));
+    opts.from_pi = (int64_t) to_maxint(opt.val.substr(pos + 1));
+  }
+  catch (std::exception&) {
+    throw primecount_error("invalid option '" + opt.str + "', expected --from=x1:pi");
+  }
+
+  opts.option = OPTION_FROM;
+}
+
+/// Parse shard string of type "i/N"
+void setShard(const std::string& str)
+{
+  std::size_t pos = str.find('/');
+  if (pos == std::string::npos)
+    throw primecount_error("invalid shard '" + str + "', expected i/N");
+
+  try {
+    int shard = (int) to_maxint(str.substr(0, pos));
+    int shards = (int) to_maxint(str.substr(pos + 1));
+    set_shard(shard, shards);
+  }
+  catch (std::exception&) {
+    throw primecount_error("invalid shard '" + str + "', expected i/N with 0 <= i < N");
+  }
+}
+
+/// Resume an interrupted computation, x and
+/// the formula are read from the backup file.
+///
+void optionResume(Option& opt,
+                  CmdOptions& opts)
+{
+  std::string filename = opt.val;
+  if (filename.empty())
+    filename = backup_file;
+
+  auto values = Backup::read(filename);
+  if (values.empty())
+    throw primecount_error("failed to read backup file: " + filename);
+
+  /// Formulas that support resuming
+  const std::map<std::string, OptionID> formulas =
+  {
+    { "pi_gourdon", OPTION_GOURDON },
+    { "pi_deleglise_rivat", OPTION_DELEGLISE_RIVAT },
+    { "AC", OPTION_AC },
+    { "D", OPTION_D },
+    { "S2_easy", OPTION_S2_EASY },
+    { "S2_hard", OPTION_S2_HARD }
+  };
+
+  std::string formula = values["formula"];
+
+  if (!formulas.count(formula) ||
+      values["x"].empty())
+    throw primecount_error("invalid backup file: " + filename);
+
+  opts.option = formulas.at(formula);
+  opts.x = to_maxint(values["x"]);
+  set_backup_file(filename);
+  set_resume(true);
+
+  if (!values["shard"].empty())
+    setShard(values["shard"]);
+}
+
 /// Parse the next command-line option.
 /// e.g. "--threads=32"
 /// -> opt.str = "--threads=32"
@@ -231,10 +379,16 @@ CmdOptions parseOptions(int argc, char* argv[])
     { "--alpha", std::make_pair(OPTION_ALPHA, REQUIRED_PARAM) },
     { "--alpha-y", std::make_pair(OPTION_ALPHA_Y, REQUIRED_PARAM) },
     { "--alpha-z", std::make_pair(OPTION_ALPHA_Z, REQUIRED_PARAM) },
+    { "--backup", std::make_pair(OPTION_BACKUP, OPTIONAL_PARAM) },
+    { "--cache-dir", std::make_pair(OPTION_CACHE_DIR, REQUIRED_PARAM) },
+    { "--count-primes", std::make_pair(OPTION_COUNT_PRIMES, NO_PARAM) },
+    { "--cpu-info", std::make_pair(OPTION_CPU_INFO, NO_PARAM) },
     { "-d", std::make_pair(OPTION_DELEGLISE_RIVAT, NO_PARAM) },
     { "--deleglise-rivat", std::make_pair(OPTION_DELEGLISE_RIVAT, NO_PARAM) },
     { "--deleglise-rivat-64", std::make_pair(OPTION_DELEGLISE_RIVAT_64, NO_PARAM) },
     { "--deleglise-rivat-128", std::make_pair(OPTION_DELEGLISE_RIVAT_128, NO_PARAM) },
+    { "--dry-run", std::make_pair(OPTION_DRY_RUN, NO_PARAM) },
+    { "--from", std::make_pair(OPTION_FROM, REQUIRED_PARAM) },
     { "-g", std::make_pair(OPTION_GOURDON, NO_PARAM) },
     { "--gourdon", std::make_pair(OPTION_GOURDON, NO_PARAM) },
     { "--gourdon-64", std::make_pair(OPTION_GOURDON_64, NO_PARAM) },
@@ -250,13 +404,17 @@ CmdOptions parseOptions(int argc, char* argv[])
     { "--lmo3", std::make_pair(OPTION_LMO3, NO_PARAM) },
     { "--lmo4", std::make_pair(OPTION_LMO4, NO_PARAM) },
     { "--lmo5", std::make_pair(OPTION_LMO5, NO_PARAM) },
+    { "--max-memory", std::make_pair(OPTION_MAX_MEMORY, REQUIRED_PARAM) },
     { "-m", std::make_pair(OPTION_MEISSEL, NO_PARAM) },
     { "--meissel", std::make_pair(OPTION_MEISSEL, NO_PARAM) },
+    { "--merge", std::make_pair(OPTION_MERGE, NO_PARAM) },
     { "-n", std::make_pair(OPTION_NTHPRIME, NO_PARAM) },
     { "--nth-prime", std::make_pair(OPTION_NTHPRIME, NO_PARAM) },
     { "--number", std::make_pair(OPTION_NUMBER, REQUIRED_PARAM) },
     { "-p", std::make_pair(OPTION_PRIMESIEVE, NO_PARAM) },
     { "--primesieve", std::make_pair(OPTION_PRIMESIEVE, NO_PARAM) },
+    { "--progress-fd", std::make_pair(OPTION_PROGRESS_FD, REQUIRED_PARAM) },
+    { "--resume", std::make_pair(OPTION_RESUME, OPTIONAL_PARAM) },
     { "--Li", std::make_pair(OPTION_LI, NO_PARAM) },
     { "--Li-inverse", std::make_pair(OPTION_LIINV, NO_PARAM) },
     { "--Ri", std::make_pair(OPTION_RI, NO_PARAM) },
@@ -267,6 +425,7 @@ CmdOptions parseOptions(int argc, char* argv[])
     { "--S2-easy", std::make_pair(OPTION_S2_EASY, NO_PARAM) },
     { "--S2-hard", std::make_pair(OPTION_S2_HARD, NO_PARAM) },
     { "--S2-trivial", std::make_pair(OPTION_S2_TRIVIAL, NO_PARAM) },
+    { "--shard", std::make_pair(OPTION_SHARD, REQUIRED_PARAM) },
     { "--AC", std::make_pair(OPTION_AC, NO_PARAM) },
     { "-B", std::make_pair(OPTION_B, NO_PARAM) },
     { "--B", std::make_pair(OPTION_B, NO_PARAM) },
@@ -289,6 +448,14 @@ CmdOptions parseOptions(int argc, char* argv[])
 
   for (int i = 1; i < argc; i++)
   {
+    // --merge FILES...
+    if (opts.option == OPTION_MERGE &&
+        !isOption(argv[i]))
+    {
+      opts.files.push_back(argv[i]);
+      continue;
+    }
+
     Option opt = parseOption(argc, argv, i, optionMap);
     OptionID optionID = optionMap.at(opt.opt).first;
 
@@ -297,6 +464,15 @@ CmdOptions parseOptions(int argc, char* argv[])
       case OPTION_ALPHA:   set_alpha(opt.to<double>()); break;
       case OPTION_ALPHA_Y: set_alpha_y(opt.to<double>()); break;
       case OPTION_ALPHA_Z: set_alpha_z(opt.to<double>()); break;
+      case OPTION_BACKUP:  optionBackup(opt); break;
+      case OPTION_CACHE_DIR: set_cache_dir(opt.val); break;
+      case OPTION_CPU_INFO: optionCpuInfo(); break;
+      case OPTION_DRY_RUN: opts.dry_run = true; break;
+      case OPTION_FROM:    optionFrom(opt, opts); break;
+      case OPTION_MAX_MEMORY: optionMaxMemory(opt); break;
+      case OPTION_PROGRESS_FD: optionProgressFd(opt); break;
+      case OPTION_RESUME:  optionResume(opt, opts); break;
+      case OPTION_SHARD:   setShard(opt.val); break;
       case OPTION_NUMBER:  numbers.push_back(opt.to<maxint_t>()); break;
       case OPTION_THREADS: set_num_threads(opt.to<int>()); break;
       case OPTION_HELP:    help(/* exitCode */ 0); break;
@@ -315,6 +491,42 @@ CmdOptions parseOptions(int argc, char* argv[])
     opts.a = numbers[1];
   }
 
+  if (opts.option == OPTION_COUNT_PRIMES)
+  {
+    if (numbers.size() < 2)
+      throw primecount_error("option --count-primes requires 2 numbers");
+    opts.b = numbers[1];
+  }
+
+  if (opts.option == OPTION_MERGE)
+  {
+    if (opts.files.empty())
+      throw primecount_error("option --merge requires backup files");
+    return opts;
+  }
+
+  if (is_shard())
+  {
+    if (opts.option != OPTION_AC &&
+        opts.option != OPTION_D &&
+        opts.option != OPTION_S2_HARD)
+      throw primecount_error("option --shard requires --AC, --D or --S2-hard");
+
+    // Each shard stores its partial result in its
+    // backup file, used by --merge.
+    if (get_backup_file().empty())
+      set_backup_file(get_shard_backup_file());
+  }
+
+  if (is_resume())
+  {
+    if (!numbers.empty() &&
+        numbers[0] != opts.x)
+      throw primecount_error("x does not match the x of the backup file");
+
+    return opts;
+  }
+
   if (numbers.empty())
     throw primecount_error("missing x number");
 
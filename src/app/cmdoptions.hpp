@@ -12,6 +12,8 @@
 
 #include <int128_t.hpp>
 #include <stdint.h>
+#include <string>
+#include <vector>
 
 namespace primecount {
 
@@ -20,10 +22,16 @@ enum OptionID
   OPTION_ALPHA,
   OPTION_ALPHA_Y,
   OPTION_ALPHA_Z,
+  OPTION_BACKUP,
+  OPTION_CACHE_DIR,
+  OPTION_COUNT_PRIMES,
+  OPTION_CPU_INFO,
   OPTION_DEFAULT,
   OPTION_DELEGLISE_RIVAT,
   OPTION_DELEGLISE_RIVAT_64,
   OPTION_DELEGLISE_RIVAT_128,
+  OPTION_DRY_RUN,
+  OPTION_FROM,
   OPTION_GOURDON,
   OPTION_GOURDON_64,
   OPTION_GOURDON_128,
@@ -36,10 +44,14 @@ enum OptionID
   OPTION_LMO3,
   OPTION_LMO4,
   OPTION_LMO5,
+  OPTION_MAX_MEMORY,
   OPTION_MEISSEL,
+  OPTION_MERGE,
   OPTION_NTHPRIME,
   OPTION_NUMBER,
   OPTION_PRIMESIEVE,
+  OPTION_PROGRESS_FD,
+  OPTION_RESUME,
   OPTION_LI,
   OPTION_LIINV,
   OPTION_RI,
@@ -50,6 +62,7 @@ enum OptionID
   OPTION_S2_EASY,
   OPTION_S2_HARD,
   OPTION_S2_TRIVIAL,
+  OPTION_SHARD,
   OPTION_AC,
   OPTION_B,
   OPTION_D,
@@ -65,9 +78,14 @@ enum OptionID
 struct CmdOptions
 {
   maxint_t x = -1;
+  maxint_t b = -1;
   int64_t a = -1;
+  int64_t from_x = -1;
+  int64_t from_pi = -1;
   int option = OPTION_DEFAULT;
   bool time = false;
+  bool dry_run = false;
+  std::vector<std::string> files;
 };
 
 CmdOptions parseOptions(int, char**);
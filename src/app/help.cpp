@@ -23,19 +23,40 @@ void help(int exitCode)
     "\n"
     "Options:\n"
     "\n"
+    "      --backup[=FILE]    Regularly store the progress of the computation\n"
+    "                         in FILE (default: primecount.backup)\n"
+    "      --cache-dir=DIR    Store the results of large computations and the\n"
+    "                         largest PiTable in DIR and reuse them later\n"
+    "      --cpu-info         Print the CPU features detected at runtime and\n"
+    "                         the algorithms selected for them\n"
+    "      --count-primes <A> <B>\n"
+    "                         Count the primes inside [a, b], small intervals\n"
+    "                         are counted using the sieve of Eratosthenes\n"
     "  -d, --deleglise-rivat  Count primes using the Deleglise-Rivat algorithm\n"
+    "      --dry-run          Print the estimated memory usage and run time\n"
+    "                         of pi(x) without computing pi(x)\n"
+    "      --from=X1:PI       Compute pi(x) using the known PI = pi(X1). If x\n"
+    "                         is close to X1 the primes inside the gap are\n"
+    "                         counted using the sieve of Eratosthenes\n"
     "  -g, --gourdon          Count primes using Xavier Gourdon's algorithm.\n"
     "                         This is the default algorithm.\n"
     "  -l, --legendre         Count primes using Legendre's formula\n"
     "      --lehmer           Count primes using Lehmer's formula\n"
     "      --lmo              Count primes using Lagarias-Miller-Odlyzko\n"
     "  -m, --meissel          Count primes using Meissel's formula\n"
+    "      --max-memory=SIZE  Limit the memory usage of pi(x) e.g. 8G. Uses\n"
+    "                         a smaller y and z (more run time) if needed\n"
+    "      --merge FILES      Add up the partial results of all shards\n"
     "      --Li               Approximate pi(x) using the logarithmic integral\n"
     "      --Li-inverse       Approximate the nth prime using Li^-1(x)\n"
     "  -n, --nth-prime        Calculate the nth prime\n"
     "  -p, --primesieve       Count primes using the sieve of Eratosthenes\n"
     "      --phi <X> <A>      phi(x, a) counts the numbers <= x that are not\n"
     "                         divisible by any of the first a primes\n"
+    "      --progress-fd=FD   Write the progress of the computation as JSON\n"
+    "                         lines to the file descriptor FD\n"
+    "      --resume[=FILE]    Resume an interrupted computation from FILE\n"
+    "                         (default: primecount.backup)\n"
     "      --Ri               Approximate pi(x) using Riemann R\n"
     "      --Ri-inverse       Approximate the nth prime using Ri^-1(x)\n"
     "  -s, --status[=NUM]     Show computation progress 1%, 2%, 3%, ...\n"
@@ -64,7 +85,13 @@ void help(int exitCode)
     "      --B                Compute the B formula\n"
     "      --D                Compute the D formula\n"
     "      --Phi0             Compute the Phi0 formula\n"
-    "      --Sigma            Compute the 7 Sigma formulas\n";
+    "      --Sigma            Compute the 7 Sigma formulas\n"
+    "\n"
+    "Distributed computing (--AC, --D, --S2-hard):\n"
+    "\n"
+    "      --shard=i/N        Only compute the i-th of N parts (0 <= i < N),\n"
+    "                         the partial result is stored in the backup file\n"
+    "                         primecount-shard-i-of-N.backup (or --backup=FILE)\n";
 
   std::cout << helpMenu << std::endl;
   std::exit(exitCode);
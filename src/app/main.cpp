@@ -10,6 +10,7 @@
 
 #include "cmdoptions.hpp"
 
+#include <backup.hpp>
 #include <primecount.hpp>
 #include <primecount-internal.hpp>
 #include <gourdon.hpp>
@@ -332,6 +333,30 @@ maxint_t S2_hard(maxint_t x, int threads)
     return S2_hard(x, y, z, c, Li(x), threads);
 }
 
+/// primecount --dry-run: print the estimated
+/// memory usage and run time of pi(x).
+///
+void dry_run(maxint_t x, int option, int threads)
+{
+  if (x < 2)
+    throw primecount_error("option --dry-run requires x >= 2");
+
+  switch (option)
+  {
+    case OPTION_DEFAULT:
+    case OPTION_GOURDON:
+    case OPTION_GOURDON_64:
+    case OPTION_GOURDON_128:
+      dry_run_gourdon(x, threads); break;
+    case OPTION_DELEGLISE_RIVAT:
+    case OPTION_DELEGLISE_RIVAT_64:
+    case OPTION_DELEGLISE_RIVAT_128:
+      dry_run_deleglise_rivat(x, threads); break;
+    default:
+      throw primecount_error("option --dry-run is only supported by the Gourdon and Deleglise-Rivat algorithms");
+  }
+}
+
 } // namespace
 
 int main (int argc, char* argv[])
@@ -346,14 +371,24 @@ int main (int argc, char* argv[])
     auto threads = get_num_threads();
     maxint_t res = 0;
 
+    if (opt.dry_run)
+    {
+      dry_run(x, opt.option, threads);
+      return 0;
+    }
+
     switch (opt.option)
     {
       case OPTION_DEFAULT:
         res = pi(x, threads); break;
+      case OPTION_COUNT_PRIMES:
+        res = count_primes(x, opt.b, threads); break;
       case OPTION_DELEGLISE_RIVAT:
         res = pi_deleglise_rivat(x, threads); break;
       case OPTION_DELEGLISE_RIVAT_64:
         res = pi_deleglise_rivat_64(to_int64(x), threads); break;
+      case OPTION_FROM:
+        res = pi_from(opt.from_x, opt.from_pi, to_int64(x), threads); break;
       case OPTION_GOURDON:
         res = pi_gourdon(x, threads); break;
       case OPTION_GOURDON_64:
@@ -410,6 +445,8 @@ int main (int argc, char* argv[])
         res = Phi0(x, threads); break;
       case OPTION_SIGMA:
         res = Sigma(x, threads); break;
+      case OPTION_MERGE:
+        res = merge_shards(opt.files); break;
 #ifdef HAVE_INT128_T
       case OPTION_DELEGLISE_RIVAT_128:
         res = pi_deleglise_rivat_128(x, threads); break;
@@ -0,0 +1,437 @@
+///
+/// @file  backup.cpp
+/// @brief The Backup class stores the results of the partial
+///        formulas of a long running pi(x) computation (as well as
+///        the progress of the formulas that are still running) in a
+///        small text file. If the computation is interrupted (e.g.
+///        because the server is rebooted) it can later be resumed
+///        from the last consistent state using --resume.
+///
+///        The backup file uses a simple line based format:
+///        key = value
+///
+///        In order to ensure that the backup file is always in a
+///        consistent state we first write the new backup to a
+///        temporary file and then rename the temporary file to the
+///        backup file.
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <backup.hpp>
+#include <primecount.hpp>
+#include <primecount-internal.hpp>
+#include <int128_t.hpp>
+#include <to_string.hpp>
+
+#include <stdint.h>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Increase the backup version whenever the
+// format of the backup file changes.
+const std::string backup_version = "1";
+
+std::string backup_file_;
+double backup_interval_ = 60;
+bool resume_ = false;
+int shard_ = 0;
+int shards_ = 1;
+
+// Only the outermost computation owns the backup
+// file (and the shard), nested computations which
+// use the same x share the backup file of their parent.
+std::mutex mutex_;
+bool is_owned_ = false;
+primecount::maxint_t owner_x_ = 0;
+
+// Formulas that are computed concurrently (e.g. D and
+// AC) update the shared backup file at the same time.
+std::mutex file_mutex_;
+
+std::string trim(const std::string& str)
+{
+  std::size_t first = str.find_first_not_of(" \t\r\n");
+  std::size_t last = str.find_last_not_of(" \t\r\n");
+
+  if (first == std::string::npos)
+    return "";
+
+  return str.substr(first, last - first + 1);
+}
+
+std::string shard_str()
+{
+  return std::to_string(shard_) + "/" + std::to_string(shards_);
+}
+
+} // namespace
+
+namespace primecount {
+
+void set_backup_file(const std::string& filename)
+{
+  backup_file_ = filename;
+}
+
+/// Minimum number of seconds between 2 backups
+/// of the same formula.
+///
+void set_backup_interval(double seconds)
+{
+  backup_interval_ = in_between(0, seconds, 1e9);
+}
+
+void set_resume(bool resume)
+{
+  resume_ = resume;
+}
+
+const std::string& get_backup_file()
+{
+  return backup_file_;
+}
+
+double get_backup_interval()
+{
+  return backup_interval_;
+}
+
+bool is_resume()
+{
+  return resume_;
+}
+
+void set_shard(int shard, int shards)
+{
+  if (shards < 1 ||
+      shard < 0 ||
+      shard >= shards)
+    throw primecount_error("invalid shard: " + std::to_string(shard) + "/" + std::to_string(shards));
+
+  shard_ = shard;
+  shards_ = shards;
+}
+
+int get_shard()
+{
+  return shard_;
+}
+
+int get_shards()
+{
+  return shards_;
+}
+
+bool is_shard()
+{
+  return shards_ > 1;
+}
+
+/// Only the outermost computation is split into shards.
+/// Nested computations with a different x, e.g.
+/// pi(low - 1) inside of AC(x), are computed in full.
+///
+bool is_shard(maxint_t x)
+{
+  if (!is_shard())
+    return false;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  return is_owned_ && x == owner_x_;
+}
+
+/// Returns the interval [low, high[ of the current shard.
+/// The shard boundaries are multiples of 240 as required
+/// by the Sieve and SegmentedPiTable classes (except for
+/// the upper bound of the last shard which is limit).
+///
+std::pair<int64_t, int64_t> get_shard_range(maxint_t x, int64_t limit)
+{
+  if (!is_shard(x))
+    return std::make_pair((int64_t) 0, limit);
+
+  auto shard_low = [&](int shard) {
+    int64_t low = (int64_t) ((maxint_t) limit * shard / shards_);
+    low -= low % 240;
+    return low;
+  };
+
+  int64_t low = shard_low(shard_);
+  int64_t high = limit;
+
+  if (shard_ + 1 < shards_)
+    high = shard_low(shard_ + 1);
+
+  return std::make_pair(low, high);
+}
+
+/// Default backup file name of the current shard
+std::string get_shard_backup_file()
+{
+  return "primecount-shard-" + std::to_string(shard_) + "-of-" +
+         std::to_string(shards_) + ".backup";
+}
+
+/// Add up the partial results of all shards. All backup
+/// files must belong to the same computation and each
+/// shard must be present exactly once.
+///
+maxint_t merge_shards(const std::vector<std::string>& filenames)
+{
+  if (filenames.empty())
+    throw primecount_error("merge: missing backup files");
+
+  std::vector<bool> found;
+  std::string formula;
+  std::string x;
+  maxint_t sum = 0;
+
+  for (const auto& filename : filenames)
+  {
+    auto values = Backup::read(filename);
+    if (values.empty())
+      throw primecount_error("merge: failed to read backup file: " + filename);
+
+    std::string shard = values["shard"];
+    std::size_t pos = shard.find('/');
+    if (pos == std::string::npos)
+      throw primecount_error("merge: " + filename + " is not a shard backup file");
+
+    int i = (int) to_maxint(shard.substr(0, pos));
+    int shards = (int) to_maxint(shard.substr(pos + 1));
+
+    if (found.empty())
+    {
+      formula = values["formula"];
+      x = values["x"];
+      found.resize(shards, false);
+    }
+
+    if (values["formula"] != formula ||
+        values["x"] != x ||
+        shards != (int) found.size())
+      throw primecount_error("merge: " + filename + " belongs to a different computation");
+    if (i < 0 || i >= shards || found[i])
+      throw primecount_error("merge: invalid or duplicate shard " + shard + " in " + filename);
+    if (values[formula].empty())
+      throw primecount_error("merge: shard " + shard + " has not finished yet");
+
+    found[i] = true;
+    sum += to_maxint(values[formula]);
+  }
+
+  for (std::size_t i = 0; i < found.size(); i++)
+    if (!found[i])
+      throw primecount_error("merge: missing shard " + std::to_string(i) + "/" + std::to_string(found.size()));
+
+  return sum;
+}
+
+Backup::Backup(const std::string& formula, maxint_t x)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // Nested computation, e.g. D(x) inside of pi_gourdon(x)
+  if (is_owned_)
+  {
+    if (x == owner_x_ &&
+        !backup_file_.empty())
+    {
+      is_enabled_ = true;
+      values_ = read(backup_file_);
+    }
+
+    return;
+  }
+
+  // The owner is also tracked if backups are
+  // disabled as it is needed for sharding.
+  is_owned_ = true;
+  is_owner_ = true;
+  owner_x_ = x;
+
+  if (backup_file_.empty())
+    return;
+
+  is_enabled_ = true;
+
+  if (resume_)
+  {
+    auto values = read(backup_file_);
+
+    if (values["version"] == backup_version &&
+        values["formula"] == formula &&
+        values["x"] == to_string(x) &&
+        values["shard"] == (is_shard() ? shard_str() : ""))
+    {
+      values_ = values;
+      return;
+    }
+  }
+
+  // Start a new backup
+  values_["version"] = backup_version;
+  values_["formula"] = formula;
+  values_["x"] = to_string(x);
+  if (is_shard())
+    values_["shard"] = shard_str();
+  save();
+}
+
+Backup::~Backup()
+{
+  if (is_owner_)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_owned_ = false;
+    owner_x_ = 0;
+  }
+}
+
+bool Backup::is_enabled() const
+{
+  return is_enabled_;
+}
+
+bool Backup::get(const std::string& key, std::string& value) const
+{
+  auto iter = values_.find(key);
+  if (iter == values_.end())
+    return false;
+
+  value = iter->second;
+  return true;
+}
+
+bool Backup::get(const std::string& key, maxint_t& value) const
+{
+  std::string str;
+  if (!get(key, str) || str.empty())
+    return false;
+
+  value = to_maxint(str);
+  return true;
+}
+
+void Backup::set(const std::string& key, maxint_t value)
+{
+  set(key, to_string(value));
+}
+
+/// Nested computations share the same backup file, hence we
+/// need to reload the backup file before updating it.
+///
+void Backup::set(const std::string& key, const std::string& value)
+{
+  if (!is_enabled_)
+    return;
+
+  std::lock_guard<std::mutex> lock(file_mutex_);
+
+  values_ = read(backup_file_);
+  values_[key] = value;
+  save();
+}
+
+/// Update multiple keys using a single write
+void Backup::set(const std::map<std::string, std::string>& values)
+{
+  if (!is_enabled_)
+    return;
+
+  std::lock_guard<std::mutex> lock(file_mutex_);
+
+  values_ = read(backup_file_);
+  for (const auto& kv : values)
+    values_[kv.first] = kv.second;
+  save();
+}
+
+/// Remove all keys that start with key_prefix
+void Backup::erase(const std::string& key_prefix)
+{
+  if (!is_enabled_)
+    return;
+
+  std::lock_guard<std::mutex> lock(file_mutex_);
+
+  values_ = read(backup_file_);
+
+  for (auto iter = values_.begin(); iter != values_.end();)
+  {
+    if (iter->first.compare(0, key_prefix.size(), key_prefix) == 0)
+      iter = values_.erase(iter);
+    else
+      ++iter;
+  }
+
+  save();
+}
+
+/// Atomically replace the backup file
+void Backup::save() const
+{
+  if (!is_enabled_)
+    return;
+
+  std::string tmp_file = backup_file_ + ".tmp";
+
+  {
+    std::ofstream file(tmp_file, std::ios::trunc);
+    if (!file)
+      throw primecount_error("failed to create backup file: " + tmp_file);
+
+    file << "# primecount backup file, do not edit!\n";
+    for (const auto& kv : values_)
+      file << kv.first << " = " << kv.second << '\n';
+
+    file.flush();
+    if (!file)
+      throw primecount_error("failed to write backup file: " + tmp_file);
+  }
+
+#if defined(_WIN32)
+  // On Windows std::rename() fails if the file exists
+  std::remove(backup_file_.c_str());
+#endif
+
+  if (std::rename(tmp_file.c_str(), backup_file_.c_str()) != 0)
+    throw primecount_error("failed to rename " + tmp_file + " to " + backup_file_);
+}
+
+std::map<std::string, std::string> Backup::read(const std::string& filename)
+{
+  std::map<std::string, std::string> values;
+  std::ifstream file(filename);
+  std::string line;
+
+  while (std::getline(file, line))
+  {
+    line = trim(line);
+    std::size_t pos = line.find('=');
+
+    if (line.empty() ||
+        line[0] == '#' ||
+        pos == std::string::npos)
+      continue;
+
+    std::string key = trim(line.substr(0, pos));
+    std::string value = trim(line.substr(pos + 1));
+    values[key] = value;
+  }
+
+  return values;
+}
+
+} // namespace
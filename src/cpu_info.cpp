@@ -0,0 +1,88 @@
+///
+/// @file  cpu_info.cpp
+/// @brief Print the CPU features detected at runtime and the
+///        algorithms (kernels) primecount has selected for them.
+///        Used by primecount --cpu-info.
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <primecount-internal.hpp>
+#include <cpuid.hpp>
+#include <fast_div.hpp>
+#include <popcnt.hpp>
+#include <Sieve.hpp>
+
+#include <iostream>
+#include <string>
+
+namespace {
+
+const char* yes_no(bool b)
+{
+  return b ? "yes" : "no";
+}
+
+std::string popcnt_kernel()
+{
+#if defined(ENABLE_CPUID_POPCNT)
+  return primecount::cpu_supports_popcnt ? "POPCNT (runtime dispatch)" : "bitwise (runtime dispatch)";
+#elif defined(__POPCNT__) || defined(__AVX__)
+  return "POPCNT (compile time)";
+#else
+  return "compiler builtin";
+#endif
+}
+
+std::string div_kernel()
+{
+#if defined(ENABLE_DIV32)
+  return primecount::is_div32 ? "32-bit if possible (runtime dispatch)" : "64-bit (runtime dispatch)";
+#else
+  return "64-bit (compile time)";
+#endif
+}
+
+} // namespace
+
+namespace primecount {
+
+// The CPU features used in hot code paths (popcnt64() and
+// fast_div()) are only detected once, in this translation
+// unit. Until initialized they are false, which selects the
+// portable code paths. They are always defined because code
+// compiled with other flags (e.g. the tests) may use them.
+extern const bool cpu_supports_popcnt;
+extern const bool is_div32;
+
+const bool cpu_supports_popcnt = has_cpuid_popcnt();
+const bool is_div32 = !has_fast_div64();
+
+void print_cpu_info()
+{
+#if defined(HAS_CPUID)
+  int family;
+  int model;
+  get_cpu_family_model(family, model);
+
+  std::cout << "CPU vendor: " << get_cpu_vendor() << std::endl;
+  std::cout << "CPU family: " << family << std::endl;
+  std::cout << "CPU model: " << model << std::endl;
+  std::cout << "POPCNT: " << yes_no(has_cpuid_popcnt()) << std::endl;
+  std::cout << "AVX2: " << yes_no(has_cpuid_avx2()) << std::endl;
+  std::cout << "AVX512 VPOPCNTDQ: " << yes_no(has_cpuid_avx512_vpopcnt()) << std::endl;
+  std::cout << "Fast 64-bit division: " << yes_no(has_fast_div64()) << std::endl;
+#else
+  std::cout << "CPUID: not supported on this CPU architecture" << std::endl;
+#endif
+
+  std::cout << std::endl;
+  std::cout << "popcnt64(): " << popcnt_kernel() << std::endl;
+  std::cout << "Sieve::count(): " << Sieve::get_count_kernel() << std::endl;
+  std::cout << "fast_div(): " << div_kernel() << std::endl;
+}
+
+} // namespace
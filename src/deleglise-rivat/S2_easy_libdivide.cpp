@@ -20,6 +20,7 @@
 ///
 
 #include <PiTable.hpp>
+#include <backup.hpp>
 #include <primecount-internal.hpp>
 #include <fast_div.hpp>
 #include <generate.hpp>
@@ -28,9 +29,9 @@
 #include <imath.hpp>
 #include <pod_vector.hpp>
 #include <print.hpp>
-#include <RelaxedAtomic.hpp>
-#include <StatusS2.hpp>
+#include <profiling.hpp>
 #include <S.hpp>
+#include <S2_easy.hpp>
 
 #include <libdivide.h>
 #include <stdint.h>
@@ -76,6 +77,8 @@ T S2_easy_64(T xp128,
     uint64_t xpq2 = xp / primes[pi_xpq + 1];
     uint64_t lmin = pi[xpq2];
     sum += phi_xpq * (l - lmin);
+    PROFILE_ADD(PROFILE_LEAVES, l - lmin);
+    PROFILE_ADD(PROFILE_DIVISIONS, 2);
     l = lmin;
   }
 
@@ -88,6 +91,8 @@ T S2_easy_64(T xp128,
   {
     uint64_t xpq = xp / primes[l];
     sum += pi[xpq] - b + 2;
+    PROFILE_ADD(PROFILE_LEAVES, 1);
+    PROFILE_ADD(PROFILE_DIVISIONS, 1);
   }
 
   return sum;
@@ -127,6 +132,7 @@ T S2_easy_128(T xp,
     uint64_t xpq2 = fast_div64(xp, primes[b + phi_xpq - 1]);
     uint64_t lmin = pi[xpq2];
     sum += phi_xpq * (l - lmin);
+    PROFILE_ADD(PROFILE_LEAVES, l - lmin);
     l = lmin;
   }
 
@@ -139,6 +145,7 @@ T S2_easy_128(T xp,
   {
     uint64_t xpq = fast_div64(xp, primes[l]);
     sum += pi[xpq] - b + 2;
+    PROFILE_ADD(PROFILE_LEAVES, 1);
   }
 
   return sum;
@@ -154,6 +161,7 @@ T S2_easy_OpenMP(T x,
                  int64_t z,
                  int64_t c,
                  const Primes& primes,
+                 Backup& backup,
                  int threads,
                  bool is_print)
 {
@@ -163,8 +171,7 @@ T S2_easy_OpenMP(T x,
   for (std::size_t i = 1; i < lprimes.size(); i++)
     lprimes[i] = primes[i];
 
-  T sum = 0;
-  int64_t x13 = iroot<3>(x); 
+  int64_t x13 = iroot<3>(x);
 
   // These load balancing settings work well on my
   // dual-socket AMD EPYC 7642 server with 192 CPU cores.
@@ -173,30 +180,22 @@ T S2_easy_OpenMP(T x,
   threads = std::min(threads, max_threads);
   threads = ideal_num_threads(x13, threads, thread_threshold);
 
-  StatusS2 status(x);
   PiTable pi(y, threads);
   int64_t pi_sqrty = pi[isqrt(y)];
   int64_t pi_x13 = pi[x13];
-  RelaxedAtomic<int64_t> min_b(max(c, pi_sqrty) + 1);
+  int64_t start_b = max(c, pi_sqrty) + 1;
 
-  // for (b = pi[sqrty] + 1; b <= pi_x13; b++)
-  #pragma omp parallel num_threads(threads) reduction(+: sum)
-  for (int64_t b = min_b++; b <= pi_x13; b = min_b++)
+  return S2_easy_chunks(x, y, start_b, pi_x13, backup, threads, is_print,
+    [&](int64_t b) -> T
   {
     int64_t prime = primes[b];
     T xp = x / prime;
 
     if (xp <= numeric_limits<uint64_t>::max())
-      sum += S2_easy_64(xp, y, z, b, prime, lprimes, pi);
+      return S2_easy_64(xp, y, z, b, prime, lprimes, pi);
     else
-      sum += S2_easy_128(xp, y, z, b, prime, primes, pi);
-
-    #pragma omp master
-    if (is_print)
-      status.print(b, pi_x13);
-  }
-
-  return sum;
+      return S2_easy_128(xp, y, z, b, prime, primes, pi);
+  });
 }
 
 } // namespace
@@ -210,6 +209,7 @@ int64_t S2_easy(int64_t x,
                 int threads,
                 bool is_print)
 {
+  ProfileScope profile("S2_easy");
   double time;
 
   if (is_print)
@@ -220,8 +220,19 @@ int64_t S2_easy(int64_t x,
     time = get_time();
   }
 
+  int64_t sum;
+  Backup backup("S2_easy", x);
+
+  if (backup.get("S2_easy", sum))
+  {
+    if (is_print)
+      print("S2_easy", sum, time);
+
+    return sum;
+  }
+
   auto primes = generate_primes<uint32_t>(y);
-  int64_t sum = S2_easy_OpenMP((uint64_t) x, y, z, c, primes, threads, is_print);
+  sum = S2_easy_OpenMP((uint64_t) x, y, z, c, primes, backup, threads, is_print);
 
   if (is_print)
     print("S2_easy", sum, time);
@@ -238,6 +249,7 @@ int128_t S2_easy(int128_t x,
                  int threads,
                  bool is_print)
 {
+  ProfileScope profile("S2_easy");
   double time;
 
   if (is_print)
@@ -249,17 +261,26 @@ int128_t S2_easy(int128_t x,
   }
 
   int128_t sum;
+  Backup backup("S2_easy", x);
+
+  if (backup.get("S2_easy", sum))
+  {
+    if (is_print)
+      print("S2_easy", sum, time);
+
+    return sum;
+  }
 
   // uses less memory
   if (y <= numeric_limits<uint32_t>::max())
   {
     auto primes = generate_primes<uint32_t>(y);
-    sum = S2_easy_OpenMP((uint128_t) x, y, z, c, primes, threads, is_print);
+    sum = S2_easy_OpenMP((uint128_t) x, y, z, c, primes, backup, threads, is_print);
   }
   else
   {
     auto primes = generate_primes<int64_t>(y);
-    sum = S2_easy_OpenMP((uint128_t) x, y, z, c, primes, threads, is_print);
+    sum = S2_easy_OpenMP((uint128_t) x, y, z, c, primes, backup, threads, is_print);
   }
 
   if (is_print)
@@ -34,8 +34,10 @@
 #include <imath.hpp>
 #include <int128_t.hpp>
 #include <LoadBalancerS2.hpp>
+#include <backup.hpp>
 #include <min.hpp>
 #include <print.hpp>
+#include <profiling.hpp>
 #include <S.hpp>
 
 #include <stdint.h>
@@ -127,6 +129,7 @@ T S2_hard_thread(T x,
           int64_t phi_xpm = phi[b] + sieve.count(stop);
           int64_t mu_m = factor.mu(m);
           sum -= mu_m * phi_xpm;
+          PROFILE_ADD(PROFILE_LEAVES, 1);
         }
       }
 
@@ -156,6 +159,7 @@ T S2_hard_thread(T x,
         int64_t stop = xpq - low;
         int64_t phi_xpq = phi[b] + sieve.count(stop);
         sum += phi_xpq;
+        PROFILE_ADD(PROFILE_LEAVES, 1);
       }
 
       phi[b] += sieve.get_total_count();
@@ -194,6 +198,7 @@ T S2_hard_OpenMP(T x,
                  T s2_hard_approx,
                  const Primes& primes,
                  const FactorTable& factor,
+                 Backup& backup,
                  int threads,
                  bool is_print)
 {
@@ -204,7 +209,8 @@ T S2_hard_OpenMP(T x,
   threads = std::min(threads, max_threads);
   threads = ideal_num_threads(z, threads, thread_threshold);
 
-  LoadBalancerS2 loadBalancer(x, z, s2_hard_approx, threads, is_print);
+  LoadBalancerS2 loadBalancer("S2_hard", x, z, s2_hard_approx, threads, is_print);
+  loadBalancer.resume(backup);
   int64_t max_prime = min(y, z / isqrt(y));
   PiTable pi(max_prime, threads);
 
@@ -227,6 +233,11 @@ T S2_hard_OpenMP(T x,
 
   T sum = (T) loadBalancer.get_sum();
 
+  // The S2_hard.* keys store the progress of
+  // S2_hard(x, y) which is not needed anymore.
+  backup.set("S2_hard", sum);
+  backup.erase("S2_hard.");
+
   return sum;
 }
 
@@ -242,6 +253,7 @@ int64_t S2_hard(int64_t x,
                 int threads,
                 bool is_print)
 {
+  ProfileScope profile("S2_hard");
   double time;
 
   if (is_print)
@@ -252,10 +264,21 @@ int64_t S2_hard(int64_t x,
     time = get_time();
   }
 
+  int64_t sum;
+  Backup backup("S2_hard", x);
+
+  if (backup.get("S2_hard", sum))
+  {
+    if (is_print)
+      print("S2_hard", sum, time);
+
+    return sum;
+  }
+
   FactorTable<uint16_t> factor(y, threads);
   int64_t max_prime = min(y, z / isqrt(y));
   auto primes = generate_primes<int32_t>(max_prime);
-  int64_t sum = S2_hard_OpenMP(x, y, z, c, s2_hard_approx, primes, factor, threads, is_print);
+  sum = S2_hard_OpenMP(x, y, z, c, s2_hard_approx, primes, factor, backup, threads, is_print);
 
   if (is_print)
     print("S2_hard", sum, time);
@@ -273,6 +296,7 @@ int128_t S2_hard(int128_t x,
                  int threads,
                  bool is_print)
 {
+  ProfileScope profile("S2_hard");
   double time;
 
   if (is_print)
@@ -284,6 +308,15 @@ int128_t S2_hard(int128_t x,
   }
 
   int128_t sum;
+  Backup backup("S2_hard", x);
+
+  if (backup.get("S2_hard", sum))
+  {
+    if (is_print)
+      print("S2_hard", sum, time);
+
+    return sum;
+  }
 
   // uses less memory
   if (y <= FactorTable<uint16_t>::max())
@@ -291,14 +324,14 @@ int128_t S2_hard(int128_t x,
     FactorTable<uint16_t> factor(y, threads);
     int64_t max_prime = min(y, z / isqrt(y));
     auto primes = generate_primes<uint32_t>(max_prime);
-    sum = S2_hard_OpenMP(x, y, z, c, s2_hard_approx, primes, factor, threads, is_print);
+    sum = S2_hard_OpenMP(x, y, z, c, s2_hard_approx, primes, factor, backup, threads, is_print);
   }
   else
   {
     FactorTable<uint32_t> factor(y, threads);
     int64_t max_prime = min(y, z / isqrt(y));
     auto primes = generate_primes<int64_t>(max_prime);
-    sum = S2_hard_OpenMP(x, y, z, c, s2_hard_approx, primes, factor, threads, is_print);
+    sum = S2_hard_OpenMP(x, y, z, c, s2_hard_approx, primes, factor, backup, threads, is_print);
   }
 
   if (is_print)
@@ -23,6 +23,7 @@
 #include <int128_t.hpp>
 #include <imath.hpp>
 #include <print.hpp>
+#include <profiling.hpp>
 
 #include <stdint.h>
 #include <algorithm>
@@ -67,6 +68,8 @@ T S2_trivial(T x,
     int64_t xpp = (int64_t)(x / pp);
     if (xpp <= prime) break;
     sum += pi_y - pi[xpp];
+    PROFILE_ADD(PROFILE_LEAVES, pi_y - pi[xpp]);
+    PROFILE_ADD(PROFILE_DIVISIONS, 1);
   }
 
   // For all primes[b] >= x^(1/3) && < y:
@@ -83,6 +86,7 @@ T S2_trivial(T x,
     T a1 = pi[y] - pi[y-1];
     T a2 = pi[y] - pi[prime];
     sum += n * (a1 + a2) / 2;
+    PROFILE_ADD(PROFILE_LEAVES, n * (a1 + a2) / 2);
   }
 
   return sum;
@@ -99,6 +103,7 @@ int64_t S2_trivial(int64_t x,
                    int threads,
                    bool is_print)
 {
+  ProfileScope profile("S2_trivial");
   double time;
 
   if (is_print)
@@ -126,6 +131,7 @@ int128_t S2_trivial(int128_t x,
                     int threads,
                     bool is_print)
 {
+  ProfileScope profile("S2_trivial");
   double time;
 
   if (is_print)
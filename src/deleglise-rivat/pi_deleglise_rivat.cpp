@@ -19,6 +19,8 @@
 /// file in the top level directory.
 ///
 
+#include <backup.hpp>
+#include <concurrent.hpp>
 #include <primecount.hpp>
 #include <primecount-internal.hpp>
 #include <imath.hpp>
@@ -26,6 +28,7 @@
 #include <int128_t.hpp>
 #include <macros.hpp>
 #include <print.hpp>
+#include <progress.hpp>
 #include <S.hpp>
 #include <to_string.hpp>
 
@@ -43,10 +46,38 @@ T S2(T x,
      int64_t z,
      int64_t c,
      T s2_approx,
+     Backup& backup,
      int threads,
      bool is_print)
 {
-  T s2_trivial = S2_trivial(x, y, z, c, threads, is_print);
+  // Compute S2_hard concurrently with S2_trivial and
+  // S2_easy. S2_hard takes about 1/3 of the run time of
+  // these formulas, its number of threads is rounded up to
+  // give it priority. As S2_easy is unknown when S2_hard
+  // starts we use s2_hard_approx = 0, the status of S2_hard
+  // is then estimated using its sieving limit.
+  if (is_concurrent(x, threads, is_print))
+  {
+    T s2_trivial = 0;
+    T s2_easy = 0;
+    T s2_hard = 0;
+    int threads_hard = concurrent_threads(threads, 1.0 / 3);
+
+    run_concurrently(
+      [&](int t) { s2_hard = S2_hard(x, y, z, c, (T) 0, t, is_print); }, threads_hard,
+      [&](int t) {
+        s2_trivial = backup.get_or_compute<T>("S2_trivial", is_print,
+          [&] { return S2_trivial(x, y, z, c, t, is_print); });
+        s2_easy = S2_easy(x, y, z, c, t, is_print);
+      }, threads - threads_hard);
+
+    return s2_trivial + s2_easy + s2_hard;
+  }
+
+  // S2_easy(x, y) and S2_hard(x, y) store
+  // their results in the backup file.
+  T s2_trivial = backup.get_or_compute<T>("S2_trivial", is_print,
+    [&] { return S2_trivial(x, y, z, c, threads, is_print); });
   T s2_easy = S2_easy(x, y, z, c, threads, is_print);
   T s2_hard_approx = s2_approx - (s2_trivial + s2_easy);
   T s2_hard = S2_hard(x, y, z, c, s2_hard_approx, threads, is_print);
@@ -55,6 +86,15 @@ T S2(T x,
   return s2;
 }
 
+/// Restore y of an interrupted computation as the results
+/// of the partial formulas depend on y.
+///
+void backup_vars(Backup& backup, int64_t& y)
+{
+  if (!backup.get("y", y))
+    backup.set("y", std::to_string(y));
+}
+
 } // namespace
 
 namespace primecount {
@@ -71,9 +111,11 @@ int64_t pi_deleglise_rivat_64(int64_t x,
   if (x < 2)
     return 0;
 
-  double alpha = get_alpha_deleglise_rivat(x);
-  int64_t x13 = iroot<3>(x);
-  int64_t y = (int64_t) (x13 * alpha);
+  int64_t y = get_y_deleglise_rivat(x);
+  fit_max_memory_deleglise_rivat(x, y, threads);
+  Backup backup("pi_deleglise_rivat", x);
+  Progress progress("pi_deleglise_rivat", x);
+  backup_vars(backup, y);
   int64_t z = x / y;
   int64_t pi_y = pi_noprint(y, threads);
   int64_t c = PhiTiny::get_c(y);
@@ -86,10 +128,12 @@ int64_t pi_deleglise_rivat_64(int64_t x,
     print(x, y, z, c, threads);
   }
 
-  int64_t p2 = P2(x, y, pi_y, threads, is_print);
-  int64_t s1 = S1(x, y, c, threads, is_print);
+  int64_t p2 = backup.get_or_compute<int64_t>("P2", is_print,
+    [&] { return P2(x, y, pi_y, threads, is_print); });
+  int64_t s1 = backup.get_or_compute<int64_t>("S1", is_print,
+    [&] { return S1(x, y, c, threads, is_print); });
   int64_t s2_approx = S2_approx(x, pi_y, p2, s1);
-  int64_t s2 = S2(x, y, z, c, s2_approx, threads, is_print);
+  int64_t s2 = S2(x, y, z, c, s2_approx, backup, threads, is_print);
   int64_t phi = s1 + s2;
   int64_t sum = phi + pi_y - 1 - p2;
 
@@ -116,7 +160,11 @@ int128_t pi_deleglise_rivat_128(int128_t x,
   if_unlikely(x > limit)
     throw primecount_error("pi(x): x must be <= " + to_string(limit));
 
-  int64_t y = (int64_t) (iroot<3>(x) * alpha);
+  int64_t y = get_y_deleglise_rivat(x);
+  fit_max_memory_deleglise_rivat(x, y, threads);
+  Backup backup("pi_deleglise_rivat", x);
+  Progress progress("pi_deleglise_rivat", x);
+  backup_vars(backup, y);
   int64_t z = (int64_t) (x / y);
   int64_t pi_y = pi_noprint(y, threads);
   int64_t c = PhiTiny::get_c(y);
@@ -129,10 +177,12 @@ int128_t pi_deleglise_rivat_128(int128_t x,
     print(x, y, z, c, threads);
   }
 
-  int128_t p2 = P2(x, y, pi_y, threads, is_print);
-  int128_t s1 = S1(x, y, c, threads, is_print);
+  int128_t p2 = backup.get_or_compute<int128_t>("P2", is_print,
+    [&] { return P2(x, y, pi_y, threads, is_print); });
+  int128_t s1 = backup.get_or_compute<int128_t>("S1", is_print,
+    [&] { return S1(x, y, c, threads, is_print); });
   int128_t s2_approx = S2_approx(x, pi_y, p2, s1);
-  int128_t s2 = S2(x, y, z, c, s2_approx, threads, is_print);
+  int128_t s2 = S2(x, y, z, c, s2_approx, backup, threads, is_print);
   int128_t phi = s1 + s2;
   int128_t sum = phi + pi_y - 1 - p2;
 
@@ -35,6 +35,7 @@
 #include <SegmentedPiTable.hpp>
 #include <primecount-internal.hpp>
 #include <LoadBalancerAC.hpp>
+#include <backup.hpp>
 #include <fast_div.hpp>
 #include <generate.hpp>
 #include <gourdon.hpp>
@@ -44,6 +45,7 @@
 #include <imath.hpp>
 #include <pod_vector.hpp>
 #include <print.hpp>
+#include <profiling.hpp>
 #include <RelaxedAtomic.hpp>
 
 #include <stdint.h>
@@ -84,6 +86,8 @@ T A_64(T xlow,
   {
     uint64_t xpq = xp / primes[i];
     sum += segmentedPi[xpq];
+    PROFILE_ADD(PROFILE_LEAVES, 1);
+    PROFILE_ADD(PROFILE_DIVISIONS, 1);
   }
 
   // pq = primes[b] * primes[i]
@@ -92,6 +96,8 @@ T A_64(T xlow,
   {
     uint64_t xpq = xp / primes[i];
     sum += segmentedPi[xpq] * 2;
+    PROFILE_ADD(PROFILE_LEAVES, 1);
+    PROFILE_ADD(PROFILE_DIVISIONS, 1);
   }
 
   return sum;
@@ -128,6 +134,7 @@ T A_128(T xlow,
   {
     uint64_t xpq = fast_div64(xp, primes[i]);
     sum += segmentedPi[xpq];
+    PROFILE_ADD(PROFILE_LEAVES, 1);
   }
 
   // pq = primes[b] * primes[i]
@@ -136,6 +143,7 @@ T A_128(T xlow,
   {
     uint64_t xpq = fast_div64(xp, primes[i]);
     sum += segmentedPi[xpq] * 2;
+    PROFILE_ADD(PROFILE_LEAVES, 1);
   }
 
   return sum;
@@ -180,6 +188,7 @@ T C1(T xp,
       uint64_t xpm = fast_div64(xp, m64);
       T phi_xpm = pi[xpm] - b + 2;
       sum += phi_xpm * MU;
+      PROFILE_ADD(PROFILE_LEAVES, 1);
     }
 
     sum += C1<-MU>(xp, b, i, pi_y, m64, min_m, max_m, primes, pi);
@@ -229,6 +238,8 @@ T C2_64(T xlow,
     uint64_t xpq2 = xp / primes[pi_xpq + 1];
     uint64_t imin = pi[max(xpq2, min_clustered)];
     sum += phi_xpq * (i - imin);
+    PROFILE_ADD(PROFILE_LEAVES, i - imin);
+    PROFILE_ADD(PROFILE_DIVISIONS, 2);
     i = imin;
   }
 
@@ -241,6 +252,8 @@ T C2_64(T xlow,
   {
     uint64_t xpq = xp / primes[i];
     sum += segmentedPi[xpq] - b + 2;
+    PROFILE_ADD(PROFILE_LEAVES, 1);
+    PROFILE_ADD(PROFILE_DIVISIONS, 1);
   }
 
   return sum;
@@ -287,6 +300,7 @@ T C2_128(T xlow,
     uint64_t xpq2 = fast_div64(xp, primes[pi_xpq + 1]);
     uint64_t imin = pi[max(xpq2, min_clustered)];
     sum += phi_xpq * (i - imin);
+    PROFILE_ADD(PROFILE_LEAVES, i - imin);
     i = imin;
   }
 
@@ -299,6 +313,7 @@ T C2_128(T xlow,
   {
     uint64_t xpq = fast_div64(xp, primes[i]);
     sum += segmentedPi[xpq] - b + 2;
+    PROFILE_ADD(PROFILE_LEAVES, 1);
   }
 
   return sum;
@@ -312,8 +327,8 @@ T AC_OpenMP(T x,
             int64_t z,
             int64_t k,
             int64_t x_star,
-            int64_t max_a_prime,
             const Primes& primes,
+            const PiTable& pi,
             int threads,
             bool is_print)
 {
@@ -329,7 +344,7 @@ T AC_OpenMP(T x,
   int max_threads = (int) std::pow(xz, 1 / 3.7);
   threads = std::min(threads, max_threads);
   threads = ideal_num_threads(x13, threads, thread_threshold);
-  LoadBalancerAC loadBalancer(sqrtx, y, threads, is_print);
+  LoadBalancerAC loadBalancer(x, sqrtx, y, threads, is_print);
 
   // Initialize libdivide vector from primes vector
   pod_vector<libdivide::branchfree_divider<uint64_t>> lprimes;
@@ -337,17 +352,19 @@ T AC_OpenMP(T x,
   for (std::size_t i = 1; i < lprimes.size(); i++)
     lprimes[i] = primes[i];
 
-  // PiTable's size = z because of the C1 formula.
-  // PiTable is accessed much less frequently than
-  // SegmentedPiTable, hence it is OK that PiTable's size
-  // is fairly large and does not fit into the CPU's cache.
-  PiTable pi(max(z, max_a_prime), threads);
-
   int64_t pi_y = pi[y];
   int64_t pi_sqrtz = pi[isqrt(z)];
   int64_t pi_root3_xy = pi[iroot<3>(xy)];
   int64_t pi_root3_xz = pi[iroot<3>(xz)];
-  RelaxedAtomic<int64_t> min_c1(max(k, pi_root3_xz) + 1);
+  int64_t start_c1 = max(k, pi_root3_xz) + 1;
+
+  // In distributed mode (--shard=i/N) the C1 formula
+  // is only computed by the first shard.
+  if (is_shard(x) &&
+      get_shard() != 0)
+    start_c1 = pi_sqrtz + 1;
+
+  RelaxedAtomic<int64_t> min_c1(start_c1);
 
   // In order to reduce the thread creation & destruction
   // overhead we reuse the same threads throughout the
@@ -385,7 +402,8 @@ T AC_OpenMP(T x,
     while (loadBalancer.get_work(low, high))
     {
       // Current segment [low, high[
-      segmentedPi.init(low, high);
+      int64_t count = segmentedPi.init_bits(low, high);
+      segmentedPi.init_count(loadBalancer.get_pi_low(low, high, count));
       T xlow = x / max(low, 1);
       T xhigh = x / high;
 
@@ -435,17 +453,21 @@ T AC_OpenMP(T x,
   return sum;
 }
 
-} // namespace
-
-namespace primecount {
-
-int64_t AC(int64_t x,
-           int64_t y,
-           int64_t z,
-           int64_t k,
-           int threads,
-           bool is_print)
+/// Compute A + C using the shared primes and PiTable,
+/// prints the result and stores it in the backup file.
+///
+template <typename T,
+          typename Primes>
+T AC_backup(T x,
+            int64_t y,
+            int64_t z,
+            int64_t k,
+            const Primes& primes,
+            const PiTable& pi,
+            int threads,
+            bool is_print)
 {
+  ProfileScope profile("AC");
   double time;
 
   if (is_print)
@@ -456,13 +478,22 @@ int64_t AC(int64_t x,
     time = get_time();
   }
 
+  T sum;
+  Backup backup("AC", x);
+
+  if (backup.get("AC", sum))
+  {
+    if (is_print)
+      print("A + C", sum, time);
+
+    return sum;
+  }
+
+  using UT = typename std::make_unsigned<T>::type;
   int64_t x_star = get_x_star_gourdon(x, y);
-  int64_t max_c_prime = y;
-  int64_t max_a_prime = (int64_t) isqrt(x / x_star);
-  int64_t max_prime = max(max_a_prime, max_c_prime);
-  auto primes = generate_primes<uint32_t>(max_prime);
+  sum = (T) AC_OpenMP((UT) x, y, z, k, x_star, primes, pi, threads, is_print);
 
-  int64_t sum = AC_OpenMP((uint64_t) x, y, z, k, x_star, max_a_prime, primes, threads, is_print);
+  backup.set("AC", sum);
 
   if (is_print)
     print("A + C", sum, time);
@@ -470,6 +501,45 @@ int64_t AC(int64_t x,
   return sum;
 }
 
+} // namespace
+
+namespace primecount {
+
+int64_t AC(int64_t x,
+           int64_t y,
+           int64_t z,
+           int64_t k,
+           int threads,
+           bool is_print)
+{
+  // PiTable's size = z because of the C1 formula.
+  // PiTable is accessed much less frequently than
+  // SegmentedPiTable, hence it is OK that PiTable's size
+  // is fairly large and does not fit into the CPU's cache.
+  int64_t x_star = get_x_star_gourdon(x, y);
+  int64_t max_a_prime = (int64_t) isqrt(x / x_star);
+  int64_t max_prime = max(max_a_prime, y);
+  auto primes = generate_primes<uint32_t>(max_prime);
+  PiTable pi(max(z, max_a_prime), threads);
+
+  return AC(x, y, z, k, primes, pi, threads, is_print);
+}
+
+/// primes must contain the primes <= max(y, x_star^(1/2))
+/// and pi must be a PiTable(max(z, x_star^(1/2))).
+///
+int64_t AC(int64_t x,
+           int64_t y,
+           int64_t z,
+           int64_t k,
+           const pod_vector<uint32_t>& primes,
+           const PiTable& pi,
+           int threads,
+           bool is_print)
+{
+  return AC_backup(x, y, z, k, primes, pi, threads, is_print);
+}
+
 #ifdef HAVE_INT128_T
 
 int128_t AC(int128_t x,
@@ -479,38 +549,49 @@ int128_t AC(int128_t x,
             int threads,
             bool is_print)
 {
-  double time;
-
-  if (is_print)
-  {
-    print("");
-    print("=== AC(x, y) ===");
-    print_gourdon_vars(x, y, z, k, threads);
-    time = get_time();
-  }
-
   int64_t x_star = get_x_star_gourdon(x, y);
-  int64_t max_c_prime = y;
   int64_t max_a_prime = (int64_t) isqrt(x / x_star);
-  int64_t max_prime = max(max_a_prime, max_c_prime);
-  int128_t sum;
+  int64_t max_prime = max(max_a_prime, y);
+  PiTable pi(max(z, max_a_prime), threads);
 
   // uses less memory
   if (max_prime <= numeric_limits<uint32_t>::max())
   {
     auto primes = generate_primes<uint32_t>(max_prime);
-    sum = AC_OpenMP((uint128_t) x, y, z, k, x_star, max_a_prime, primes, threads, is_print);
+    return AC(x, y, z, k, primes, pi, threads, is_print);
   }
   else
   {
     auto primes = generate_primes<uint64_t>(max_prime);
-    sum = AC_OpenMP((uint128_t) x, y, z, k, x_star, max_a_prime, primes, threads, is_print);
+    return AC(x, y, z, k, primes, pi, threads, is_print);
   }
+}
 
-  if (is_print)
-    print("A + C", sum, time);
+/// primes must contain the primes <= max(y, x_star^(1/2))
+/// and pi must be a PiTable(max(z, x_star^(1/2))).
+///
+int128_t AC(int128_t x,
+            int64_t y,
+            int64_t z,
+            int64_t k,
+            const pod_vector<uint32_t>& primes,
+            const PiTable& pi,
+            int threads,
+            bool is_print)
+{
+  return AC_backup(x, y, z, k, primes, pi, threads, is_print);
+}
 
-  return sum;
+int128_t AC(int128_t x,
+            int64_t y,
+            int64_t z,
+            int64_t k,
+            const pod_vector<uint64_t>& primes,
+            const PiTable& pi,
+            int threads,
+            bool is_print)
+{
+  return AC_backup(x, y, z, k, primes, pi, threads, is_print);
 }
 
 #endif
@@ -26,6 +26,7 @@
 #include <PiTable.hpp>
 #include <Sieve.hpp>
 #include <LoadBalancerS2.hpp>
+#include <backup.hpp>
 #include <fast_div.hpp>
 #include <generate.hpp>
 #include <generate_phi.hpp>
@@ -34,9 +35,11 @@
 #include <int128_t.hpp>
 #include <min.hpp>
 #include <print.hpp>
+#include <profiling.hpp>
 
 #include <stdint.h>
 
+using std::numeric_limits;
 using namespace primecount;
 
 namespace {
@@ -119,6 +122,7 @@ T D_thread(T x,
           int64_t phi_xpm = phi[b] + sieve.count(stop);
           int64_t mu_m = factor.mu(m);
           sum -= mu_m * phi_xpm;
+          PROFILE_ADD(PROFILE_LEAVES, 1);
         }
       }
 
@@ -140,15 +144,16 @@ T D_thread(T x,
       int64_t max_m = min(fast_div(xp, prime * prime), xp_low);
       int64_t l = pi[max_m];
 
-      if (prime >= primes[l])
+      if (prime >= (int64_t) primes[l])
         goto next_segment;
 
-      for (; primes[l] > min_m; l--)
+      for (; (int64_t) primes[l] > min_m; l--)
       {
         int64_t xpq = fast_div64(xp, primes[l]);
         int64_t stop = xpq - low;
         int64_t phi_xpq = phi[b] + sieve.count(stop);
         sum += phi_xpq;
+        PROFILE_ADD(PROFILE_LEAVES, 1);
       }
 
       phi[b] += sieve.get_total_count();
@@ -186,7 +191,9 @@ T D_OpenMP(T x,
            int64_t k,
            T d_approx,
            const Primes& primes,
+           const PiTable& pi,
            const FactorTableD& factor,
+           Backup& backup,
            int threads,
            bool is_print)
 {
@@ -199,8 +206,8 @@ T D_OpenMP(T x,
   int max_threads = (int) std::pow(xz, 1 / 3.7);
   threads = std::min(threads, max_threads);
   threads = ideal_num_threads(xz, threads, thread_threshold);
-  LoadBalancerS2 loadBalancer(x, xz, d_approx, threads, is_print);
-  PiTable pi(y, threads);
+  LoadBalancerS2 loadBalancer("D", x, xz, d_approx, threads, is_print);
+  loadBalancer.resume(backup);
 
   #pragma omp parallel num_threads(threads)
   {
@@ -221,21 +228,30 @@ T D_OpenMP(T x,
 
   T sum = (T) loadBalancer.get_sum();
 
+  // The D.* keys store the progress of D(x, y)
+  // which is not needed anymore.
+  backup.set("D", sum);
+  backup.erase("D.");
+
   return sum;
 }
 
-} // namespace
-
-namespace primecount {
-
-int64_t D(int64_t x,
-          int64_t y,
-          int64_t z,
-          int64_t k,
-          int64_t d_approx,
-          int threads,
-          bool is_print)
+/// Compute D using the given primes and PiTable,
+/// prints the result and stores it in the backup file.
+///
+template <typename T,
+          typename Primes>
+T D_backup(T x,
+           int64_t y,
+           int64_t z,
+           int64_t k,
+           T d_approx,
+           const Primes& primes,
+           const PiTable& pi,
+           int threads,
+           bool is_print)
 {
+  ProfileScope profile("D");
   double time;
 
   if (is_print)
@@ -246,9 +262,28 @@ int64_t D(int64_t x,
     time = get_time();
   }
 
-  FactorTableD<uint16_t> factor(y, z, threads);
-  auto primes = generate_primes<int32_t>(y);
-  int64_t sum = D_OpenMP(x, y, z, k, d_approx, primes, factor, threads, is_print);
+  T sum;
+  Backup backup("D", x);
+
+  if (backup.get("D", sum))
+  {
+    if (is_print)
+      print("D", sum, time);
+
+    return sum;
+  }
+
+  // uses less memory
+  if (z <= FactorTableD<uint16_t>::max())
+  {
+    FactorTableD<uint16_t> factor(y, z, threads);
+    sum = D_OpenMP(x, y, z, k, d_approx, primes, pi, factor, backup, threads, is_print);
+  }
+  else
+  {
+    FactorTableD<uint32_t> factor(y, z, threads);
+    sum = D_OpenMP(x, y, z, k, d_approx, primes, pi, factor, backup, threads, is_print);
+  }
 
   if (is_print)
     print("D", sum, time);
@@ -256,6 +291,40 @@ int64_t D(int64_t x,
   return sum;
 }
 
+} // namespace
+
+namespace primecount {
+
+int64_t D(int64_t x,
+          int64_t y,
+          int64_t z,
+          int64_t k,
+          int64_t d_approx,
+          int threads,
+          bool is_print)
+{
+  auto primes = generate_primes<uint32_t>(y);
+  PiTable pi(y, threads);
+
+  return D(x, y, z, k, d_approx, primes, pi, threads, is_print);
+}
+
+/// primes must contain the primes <= y
+/// and pi must be a PiTable(>= y).
+///
+int64_t D(int64_t x,
+          int64_t y,
+          int64_t z,
+          int64_t k,
+          int64_t d_approx,
+          const pod_vector<uint32_t>& primes,
+          const PiTable& pi,
+          int threads,
+          bool is_print)
+{
+  return D_backup(x, y, z, k, d_approx, primes, pi, threads, is_print);
+}
+
 #ifdef HAVE_INT128_T
 
 int128_t D(int128_t x,
@@ -266,36 +335,48 @@ int128_t D(int128_t x,
            int threads,
            bool is_print)
 {
-  double time;
-
-  if (is_print)
-  {
-    print("");
-    print("=== D(x, y) ===");
-    print_gourdon_vars(x, y, z, k, threads);
-    time = get_time();
-  }
-
-  int128_t sum;
+  PiTable pi(y, threads);
 
   // uses less memory
-  if (z <= FactorTableD<uint16_t>::max())
+  if (y <= numeric_limits<uint32_t>::max())
   {
-    FactorTableD<uint16_t> factor(y, z, threads);
     auto primes = generate_primes<uint32_t>(y);
-    sum = D_OpenMP(x, y, z, k, d_approx, primes, factor, threads, is_print);
+    return D(x, y, z, k, d_approx, primes, pi, threads, is_print);
   }
   else
   {
-    FactorTableD<uint32_t> factor(y, z, threads);
-    auto primes = generate_primes<int64_t>(y);
-    sum = D_OpenMP(x, y, z, k, d_approx, primes, factor, threads, is_print);
+    auto primes = generate_primes<uint64_t>(y);
+    return D(x, y, z, k, d_approx, primes, pi, threads, is_print);
   }
+}
 
-  if (is_print)
-    print("D", sum, time);
+/// primes must contain the primes <= y
+/// and pi must be a PiTable(>= y).
+///
+int128_t D(int128_t x,
+           int64_t y,
+           int64_t z,
+           int64_t k,
+           int128_t d_approx,
+           const pod_vector<uint32_t>& primes,
+           const PiTable& pi,
+           int threads,
+           bool is_print)
+{
+  return D_backup(x, y, z, k, d_approx, primes, pi, threads, is_print);
+}
 
-  return sum;
+int128_t D(int128_t x,
+           int64_t y,
+           int64_t z,
+           int64_t k,
+           int128_t d_approx,
+           const pod_vector<uint64_t>& primes,
+           const PiTable& pi,
+           int threads,
+           bool is_print)
+{
+  return D_backup(x, y, z, k, d_approx, primes, pi, threads, is_print);
 }
 
 #endif
@@ -14,6 +14,7 @@
 ///
 
 #include <LoadBalancerAC.hpp>
+#include <backup.hpp>
 #include <SegmentedPiTable.hpp>
 #include <primecount-config.hpp>
 #include <primecount-internal.hpp>
@@ -36,7 +37,8 @@ constexpr int64_t l2_segment_size = L2_CACHE_SIZE * numbers_per_byte;
 
 namespace primecount {
 
-LoadBalancerAC::LoadBalancerAC(int64_t sqrtx,
+LoadBalancerAC::LoadBalancerAC(maxint_t x,
+                               int64_t sqrtx,
                                int64_t y,
                                int threads,
                                bool is_print) :
@@ -44,16 +46,30 @@ LoadBalancerAC::LoadBalancerAC(int64_t sqrtx,
   x14_(isqrt(sqrtx)),
   y_(y),
   threads_(threads),
-  is_print_(is_print)
+  is_print_(is_print),
+  progress_("AC", x)
 {
   lock_.init(threads);
 
+  // If the user has set a memory limit we
+  // may have to use a smaller segment size.
+  int64_t max_bytes = get_thread_memory(threads);
+  int64_t max_size = l2_segment_size;
+  if (max_bytes < L2_CACHE_SIZE)
+    max_size = max_bytes * numbers_per_byte;
+
+  // In distributed mode (--shard=i/N) this
+  // process only computes [low_, high_[.
+  auto shard = get_shard_range(x, sqrtx_);
+  low_ = shard.first;
+  high_ = shard.second;
+
   // When a single thread is used (and printing is
   // disabled) we can use a segment size larger
   // than x^(1/4) because load balancing is only
   // useful for multi-threading.
   if (threads == 1 && !is_print)
-    segment_size_ = std::max(x14_, l2_segment_size);
+    segment_size_ = std::max(x14_, max_size);
   else
   {
     // The default segment size is x^(1/4). This
@@ -69,7 +85,7 @@ LoadBalancerAC::LoadBalancerAC(int64_t sqrtx,
     {
       int64_t max_segment_size = (sqrtx_ - y_) / (threads_ * 8);
       large_segment_size_ = segment_size_ * 16;
-      large_segment_size_ = min3(large_segment_size_, l2_segment_size, max_segment_size);
+      large_segment_size_ = min3(large_segment_size_, max_size, max_segment_size);
       large_segment_size_ = std::max(segment_size_, large_segment_size_);
     }
   }
@@ -77,13 +93,18 @@ LoadBalancerAC::LoadBalancerAC(int64_t sqrtx,
   validate_segment_sizes();
   compute_total_segments();
   print_status();
+
+  // PrimePi[low_ - 1] is only computed from scratch
+  // for the first segment of this process' shard.
+  pi_high_ = low_;
+  pi_count_ = SegmentedPiTable::get_pi_low(low_, threads_);
 }
 
 bool LoadBalancerAC::get_work(int64_t& low, int64_t& high)
 {
   LockGuard lockGuard(lock_);
 
-  if (low_ >= sqrtx_)
+  if (low_ >= high_)
     return false;
 
   // Most special leaves are below y (~ x^(1/3) * log(x)).
@@ -96,12 +117,37 @@ bool LoadBalancerAC::get_work(int64_t& low, int64_t& high)
 
   low = low_;
   high = low + segment_size_;
-  high = std::min(high, sqrtx_);
+  high = std::min(high, high_);
   low_ = high;
   segment_nr_++;
   print_status();
 
-  return low < sqrtx_;
+  return low < high_;
+}
+
+/// Returns PrimePi[low - 1] of the segment [low, high[ and
+/// passes on PrimePi[high - 1] to the next segment. count
+/// is the number of primes >= 7 inside [low, high[ which
+/// have just been sieved by the calling thread. The calling
+/// thread waits until all segments < low have been sieved.
+/// Since the segments are distributed in increasing order
+/// this wait is usually short.
+///
+int64_t LoadBalancerAC::get_pi_low(int64_t low,
+                                   int64_t high,
+                                   int64_t count)
+{
+  std::unique_lock<std::mutex> lock(pi_mutex_);
+  pi_cond_.wait(lock, [&] { return pi_high_ == low; });
+
+  int64_t pi_low = pi_count_;
+  pi_count_ += count;
+  pi_high_ = high;
+
+  lock.unlock();
+  pi_cond_.notify_all();
+
+  return pi_low;
 }
 
 void LoadBalancerAC::validate_segment_sizes()
@@ -114,9 +160,10 @@ void LoadBalancerAC::validate_segment_sizes()
 
 void LoadBalancerAC::compute_total_segments()
 {
-  int64_t small_segments = ceil_div(y_, segment_size_);
-  int64_t threshold = std::min(small_segments * segment_size_, sqrtx_);
-  int64_t large_segments = ceil_div(sqrtx_ - threshold, large_segment_size_);
+  int64_t small_high = std::min(std::max(y_, low_), high_);
+  int64_t small_segments = ceil_div(small_high - low_, segment_size_);
+  int64_t threshold = std::min(low_ + small_segments * segment_size_, high_);
+  int64_t large_segments = ceil_div(high_ - threshold, large_segment_size_);
   total_segments_ = small_segments + large_segments;
 }
 
@@ -134,6 +181,20 @@ void LoadBalancerAC::print_status()
       std::cout << "\rSegments: " << segment_nr_ << "/" << total_segments_ << std::flush;
     }
   }
+
+  // --progress-fd JSON output
+  if (progress_.is_due())
+  {
+    double percent = get_percent(segment_nr_, total_segments_);
+
+    progress_.line("progress")
+      .add_double("percent", percent)
+      .add_double("remaining_secs", progress_.remaining_secs(percent))
+      .add_int("segments", segment_nr_)
+      .add_int("total_segments", total_segments_)
+      .add_int("segment_size", segment_size_)
+      .write();
+  }
 }
 
 } // namespace
@@ -26,6 +26,7 @@
 #include <imath.hpp>
 #include <int128_t.hpp>
 #include <print.hpp>
+#include <profiling.hpp>
 #include <pod_vector.hpp>
 
 #include <stdint.h>
@@ -57,6 +58,8 @@ T Phi0_thread(T x,
     T next = square_free * primes[b];
     if (next > z) break;
     phi0 += MU * phi_tiny(x / next, k);
+    PROFILE_ADD(PROFILE_LEAVES, 1);
+    PROFILE_ADD(PROFILE_DIVISIONS, 1);
     phi0 += Phi0_thread<-MU>(x, z, b, k, next, primes);
   }
 
@@ -87,6 +90,8 @@ X Phi0_OpenMP(X x,
   for (int64_t b = k + 1; b <= pi_y; b++)
   {
     phi0 -= phi_tiny(x / primes[b], k);
+    PROFILE_ADD(PROFILE_LEAVES, 1);
+    PROFILE_ADD(PROFILE_DIVISIONS, 1);
     phi0 += Phi0_thread<1>(x, z, b, k, (X) primes[b], primes);
   }
 
@@ -104,6 +109,7 @@ int64_t Phi0(int64_t x,
              int threads,
              bool is_print)
 {
+  ProfileScope profile("Phi0");
   double time;
 
   if (is_print)
@@ -131,6 +137,7 @@ int128_t Phi0(int128_t x,
               int threads,
               bool is_print)
 {
+  ProfileScope profile("Phi0");
   double time;
 
   if (is_print)
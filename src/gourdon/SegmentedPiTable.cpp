@@ -36,6 +36,10 @@
 
 namespace primecount {
 
+/// Initialize the segment [low, high[ using a single thread.
+/// In AC.cpp the threads instead use init_bits() and
+/// init_count() and get PrimePi[low] from LoadBalancerAC.
+///
 void SegmentedPiTable::init(uint64_t low, uint64_t high)
 {
   ASSERT(low < high);
@@ -43,17 +47,39 @@ void SegmentedPiTable::init(uint64_t low, uint64_t high)
   int threads = 1;
   uint64_t pi_low;
 
-  // In order to make the threads completely independent
-  // from each other each thread needs compute PrimePi[low]
-  // at the start of each new segment. If only a single
-  // thread is used we can compute PrimePi[low] in O(1) by
-  // getting that value from the previous segment.
-  if (low <= 5)
-    pi_low = pi_tiny_[5];
-  else if (low == high_)
+  // If the segments are contiguous we can compute
+  // PrimePi[low] in O(1) by getting that value from
+  // the previous segment.
+  if (low > 5 && low == high_)
     pi_low = operator[](low - 1);
   else
-    pi_low = pi_noprint(low - 1, threads);
+    pi_low = get_pi_low(low, threads);
+
+  init_bits(low, high);
+  init_count(pi_low);
+}
+
+/// Returns PrimePi[low - 1], the count of the first
+/// pi_t block of the segment [low, high[. If low <= 5
+/// this returns PrimePi[5] as the bits of the
+/// SegmentedPiTable only include the primes >= 7.
+///
+uint64_t SegmentedPiTable::get_pi_low(uint64_t low, int threads)
+{
+  if (low <= 5)
+    return pi_tiny_[5];
+  else
+    return pi_noprint(low - 1, threads);
+}
+
+/// Sieve the primes inside [low, high[ and set their bits,
+/// the counts are initialized later using init_count().
+/// Returns the number of bits that have been set.
+///
+uint64_t SegmentedPiTable::init_bits(uint64_t low, uint64_t high)
+{
+  ASSERT(low < high);
+  ASSERT(low % 240 == 0);
 
   low_ = low;
   high_ = high;
@@ -64,20 +90,14 @@ void SegmentedPiTable::init(uint64_t low, uint64_t high)
   pi_.resize(size);
   std::fill(pi_.begin(), pi_.end(), pi_t{0, 0});
 
-  init_bits();
-  init_count(pi_low);
-}
-
-/// Each thread computes PrimePi [low, high[
-void SegmentedPiTable::init_bits()
-{
   // Iterate over primes >= 7
-  uint64_t low = max(low_, 7);
+  low = max(low_, 7);
   if (low >= high_)
-    return;
+    return 0;
 
   primesieve::iterator it(low, high_);
   uint64_t prime = 0;
+  uint64_t count = 0;
 
   // Each thread iterates over the primes
   // inside [low, high[ and initializes
@@ -86,7 +106,10 @@ void SegmentedPiTable::init_bits()
   {
     uint64_t p = prime - low_;
     pi_[p / 240].bits |= set_bit_[p % 240];
+    count++;
   }
+
+  return count;
 }
 
 /// Each thread computes PrimePi [low, high[
@@ -20,6 +20,7 @@
 #include <imath.hpp>
 #include <PiTable.hpp>
 #include <print.hpp>
+#include <profiling.hpp>
 
 #include <stdint.h>
 
@@ -87,6 +88,7 @@ T Sigma456(T x,
     int64_t sqrt_xp = isqrt(x / prime);
     int64_t pi_sqrt_xp = pi[sqrt_xp];
     sigma6 += pi_sqrt_xp * (T) pi_sqrt_xp;
+    PROFILE_ADD(PROFILE_DIVISIONS, 2);
   }
 
   sigma4 *= a;
@@ -104,6 +106,7 @@ int64_t Sigma(int64_t x,
               int threads,
               bool is_print)
 {
+  ProfileScope profile("Sigma");
   double time;
 
   if (is_print)
@@ -145,6 +148,7 @@ int128_t Sigma(int128_t x,
                int threads,
                bool is_print)
 {
+  ProfileScope profile("Sigma");
   double time;
 
   if (is_print)
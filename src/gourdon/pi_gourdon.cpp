@@ -16,18 +16,113 @@
 ///
 
 #include <gourdon.hpp>
+#include <backup.hpp>
+#include <concurrent.hpp>
 #include <primecount.hpp>
 #include <primecount-internal.hpp>
 #include <imath.hpp>
+#include <generate.hpp>
 #include <macros.hpp>
 #include <PhiTiny.hpp>
+#include <PiTable.hpp>
 #include <print.hpp>
+#include <progress.hpp>
 #include <to_string.hpp>
 
 #include <stdint.h>
 #include <algorithm>
+#include <limits>
+#include <map>
 #include <string>
 
+namespace {
+
+using namespace primecount;
+
+/// Restore y, z and k of an interrupted computation as the
+/// results of the partial formulas depend on these variables.
+///
+void backup_vars(Backup& backup,
+                 int64_t& y,
+                 int64_t& z,
+                 int64_t& k)
+{
+  if (!backup.get("y", y) ||
+      !backup.get("z", z) ||
+      !backup.get("k", k))
+  {
+    std::map<std::string, std::string> values;
+    values["y"] = std::to_string(y);
+    values["z"] = std::to_string(z);
+    values["k"] = std::to_string(k);
+    backup.set(values);
+  }
+}
+
+/// Compute A + C, B and D one after the other. The AC and
+/// D formulas generate their own primes and PiTable which
+/// are freed before the next formula starts.
+///
+template <typename T>
+T AC_B_D(T x,
+         int64_t y,
+         int64_t z,
+         int64_t k,
+         T sigma,
+         T phi0,
+         Backup& backup,
+         int threads,
+         bool is_print)
+{
+  T ac = backup.get_or_compute<T>("AC", is_print,
+    [&] { return AC(x, y, z, k, threads, is_print); });
+  T b = backup.get_or_compute<T>("B", is_print,
+    [&] { return B(x, y, threads, is_print); });
+  T d_approx = D_approx(x, sigma, phi0, ac, b);
+  T d = D(x, y, z, k, d_approx, threads, is_print);
+
+  return ac - b + d;
+}
+
+/// Compute D concurrently with A + C and B. As the AC and
+/// D formulas are alive at the same time they share the
+/// primes <= max(y, x_star^(1/2)) and the
+/// PiTable(max(z, x_star^(1/2))).
+///
+template <typename T, typename Primes>
+T AC_B_D_concurrent(T x,
+                    int64_t y,
+                    int64_t z,
+                    int64_t k,
+                    const Primes& primes,
+                    const PiTable& pi,
+                    Backup& backup,
+                    int threads,
+                    bool is_print)
+{
+  // D takes about 55% of the run time of these formulas, its
+  // number of threads is rounded up to give it priority. As
+  // A + C and B are unknown when D starts we use d_approx = 0,
+  // the status of D is then estimated using its sieving limit.
+  T ac = 0;
+  T b = 0;
+  T d = 0;
+  int threads_d = concurrent_threads(threads, 0.55);
+
+  run_concurrently(
+    [&](int t) { d = D(x, y, z, k, (T) 0, primes, pi, t, is_print); }, threads_d,
+    [&](int t) {
+      ac = backup.get_or_compute<T>("AC", is_print,
+        [&] { return AC(x, y, z, k, primes, pi, t, is_print); });
+      b = backup.get_or_compute<T>("B", is_print,
+        [&] { return B(x, y, t, is_print); });
+    }, threads - threads_d);
+
+  return ac - b + d;
+}
+
+} // namespace
+
 namespace primecount {
 
 /// Calculate the number of primes below x using
@@ -42,25 +137,15 @@ int64_t pi_gourdon_64(int64_t x,
   if (x < 2)
     return 0;
 
-  auto alpha = get_alpha_gourdon(x);
-  double alpha_y = alpha.first;
-  double alpha_z = alpha.second;
-  int64_t x13 = iroot<3>(x);
-  int64_t sqrtx = isqrt(x);
-  int64_t y = (int64_t)(x13 * alpha_y);
-
-  // x^(1/3) < y < x^(1/2)
-  y = std::max(y, x13 + 1);
-  y = std::min(y, sqrtx - 1);
-  y = std::max(y, (int64_t) 1);
-
+  auto yz = get_yz_gourdon(x);
+  int64_t y = yz.first;
+  int64_t z = yz.second;
   int64_t k = PhiTiny::get_k(x);
-  int64_t z = (int64_t)(y * alpha_z);
+  fit_max_memory_gourdon(x, y, z, threads, is_print);
 
-  // y <= z < x^(1/2)
-  z = std::max(z, y);
-  z = std::min(z, sqrtx - 1);
-  z = std::max(z, (int64_t) 1);
+  Backup backup("pi_gourdon", x);
+  Progress progress("pi_gourdon", x);
+  backup_vars(backup, y, z, k);
 
   if (is_print)
   {
@@ -80,13 +165,26 @@ int64_t pi_gourdon_64(int64_t x,
   // the CPU and memory (i.e. the B algorithm) we would overload
   // both the CPU and operating system.
 
-  int64_t sigma = Sigma(x, y, threads, is_print);
-  int64_t phi0 = Phi0(x, y, z, k, threads, is_print);
-  int64_t ac = AC(x, y, z, k, threads, is_print);
-  int64_t b = B(x, y, threads, is_print);
-  int64_t d_approx = D_approx(x, sigma, phi0, ac, b);
-  int64_t d = D(x, y, z, k, d_approx, threads, is_print);
-  int64_t sum = ac - b + d + phi0 + sigma;
+  int64_t sigma = backup.get_or_compute<int64_t>("Sigma", is_print,
+    [&] { return Sigma(x, y, threads, is_print); });
+  int64_t phi0 = backup.get_or_compute<int64_t>("Phi0", is_print,
+    [&] { return Phi0(x, y, z, k, threads, is_print); });
+
+  int64_t sum;
+
+  if (is_concurrent(x, threads, is_print))
+  {
+    int64_t x_star = get_x_star_gourdon(x, y);
+    int64_t max_a_prime = (int64_t) isqrt(x / x_star);
+    int64_t max_prime = std::max(max_a_prime, y);
+    auto primes = generate_primes<uint32_t>(max_prime);
+    PiTable pi(std::max(z, max_a_prime), threads);
+    sum = AC_B_D_concurrent(x, y, z, k, primes, pi, backup, threads, is_print);
+  }
+  else
+    sum = AC_B_D(x, y, z, k, sigma, phi0, backup, threads, is_print);
+
+  sum += phi0 + sigma;
 
   return sum;
 }
@@ -106,29 +204,20 @@ int128_t pi_gourdon_128(int128_t x,
     return 0;
 
   auto alpha = get_alpha_gourdon(x);
-  double alpha_y = alpha.first;
-  double alpha_z = alpha.second;
-  maxint_t limit = get_max_x(alpha_y);
+  maxint_t limit = get_max_x(alpha.first);
 
   if_unlikely(x > limit)
     throw primecount_error("pi(x): x must be <= " + to_string(limit));
 
-  int64_t x13 = iroot<3>(x);
-  int64_t sqrtx = isqrt(x);
-  int64_t y = (int64_t)(x13 * alpha_y);
-
-  // x^(1/3) < y < x^(1/2)
-  y = std::max(y, x13 + 1);
-  y = std::min(y, sqrtx - 1);
-  y = std::max(y, (int64_t) 1);
-
+  auto yz = get_yz_gourdon(x);
+  int64_t y = yz.first;
+  int64_t z = yz.second;
   int64_t k = PhiTiny::get_k(x);
-  int64_t z = (int64_t)(y * alpha_z);
+  fit_max_memory_gourdon(x, y, z, threads, is_print);
 
-  // y <= z < x^(1/2)
-  z = std::max(z, y);
-  z = std::min(z, sqrtx - 1);
-  z = std::max(z, (int64_t) 1);
+  Backup backup("pi_gourdon", x);
+  Progress progress("pi_gourdon", x);
+  backup_vars(backup, y, z, k);
 
   if (is_print)
   {
@@ -148,13 +237,36 @@ int128_t pi_gourdon_128(int128_t x,
   // the CPU and memory (i.e. the B algorithm) we would overload
   // both the CPU and operating system.
 
-  int128_t sigma = Sigma(x, y, threads, is_print);
-  int128_t phi0 = Phi0(x, y, z, k, threads, is_print);
-  int128_t ac = AC(x, y, z, k, threads, is_print);
-  int128_t b = B(x, y, threads, is_print);
-  int128_t d_approx = D_approx(x, sigma, phi0, ac, b);
-  int128_t d = D(x, y, z, k, d_approx, threads, is_print);
-  int128_t sum = ac - b + d + phi0 + sigma;
+  int128_t sigma = backup.get_or_compute<int128_t>("Sigma", is_print,
+    [&] { return Sigma(x, y, threads, is_print); });
+  int128_t phi0 = backup.get_or_compute<int128_t>("Phi0", is_print,
+    [&] { return Phi0(x, y, z, k, threads, is_print); });
+
+  int128_t sum;
+
+  if (is_concurrent(x, threads, is_print))
+  {
+    int64_t x_star = get_x_star_gourdon(x, y);
+    int64_t max_a_prime = (int64_t) isqrt(x / x_star);
+    int64_t max_prime = std::max(max_a_prime, y);
+    PiTable pi(std::max(z, max_a_prime), threads);
+
+    // uses less memory
+    if (max_prime <= std::numeric_limits<uint32_t>::max())
+    {
+      auto primes = generate_primes<uint32_t>(max_prime);
+      sum = AC_B_D_concurrent(x, y, z, k, primes, pi, backup, threads, is_print);
+    }
+    else
+    {
+      auto primes = generate_primes<uint64_t>(max_prime);
+      sum = AC_B_D_concurrent(x, y, z, k, primes, pi, backup, threads, is_print);
+    }
+  }
+  else
+    sum = AC_B_D(x, y, z, k, sigma, phi0, backup, threads, is_print);
+
+  sum += phi0 + sigma;
 
   return sum;
 }
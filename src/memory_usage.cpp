@@ -0,0 +1,456 @@
+///
+/// @file  memory_usage.cpp
+/// @brief Estimate the memory usage of the prime counting function
+///        algorithms and reduce their memory usage if the user has
+///        set a memory limit using set_max_memory(bytes).
+///
+///        The memory usage of pi(x) is dominated by a few large
+///        lookup tables: FactorTable(y) or FactorTableD(z),
+///        PiTable(y) or PiTable(z) and the primes <= y. The size of
+///        these lookup tables depends on y and z (see
+///        get_alpha_gourdon(x)). If the estimated memory usage
+///        exceeds the memory limit we decrease z and y. This
+///        increases the run time but allows computing pi(x) using
+///        less memory.
+///
+///        1/8 of the memory limit is reserved for the thread-local
+///        data structures (sieve arrays, caches), see
+///        get_thread_memory(threads).
+///
+///        primecount --dry-run prints the estimated memory usage
+///        and run time of pi(x) without computing pi(x).
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <primecount.hpp>
+#include <primecount-internal.hpp>
+#include <primecount-config.hpp>
+#include <backup.hpp>
+#include <concurrent.hpp>
+#include <FactorTableD.hpp>
+#include <gourdon.hpp>
+#include <imath.hpp>
+#include <int128_t.hpp>
+#include <min.hpp>
+#include <PhiTiny.hpp>
+#include <print.hpp>
+#include <to_string.hpp>
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+
+using namespace primecount;
+
+namespace {
+
+/// pi(x) <= pix_upper(x)
+int64_t pix_upper(int64_t x)
+{
+  if (x < 10)
+    return 4;
+
+  double pix = x / (std::log(x) - 1.1);
+  return (int64_t) pix + 10;
+}
+
+/// PiTable uses 16 bytes per 240 numbers
+int64_t pi_table_bytes(int64_t max_x)
+{
+  return (max_x / 240 + 1) * 16;
+}
+
+/// FactorTable and FactorTableD use 2 bytes (uint16_t)
+/// or 4 bytes (uint32_t) for each number that is
+/// not divisible by any prime <= 11.
+///
+int64_t factor_table_bytes(int64_t max_x)
+{
+  int64_t bytes = 4;
+  if (max_x <= FactorTableD<uint16_t>::max())
+    bytes = 2;
+
+  max_x = max(max_x, 1);
+  return (BaseFactorTable::to_index(max_x) + 1) * bytes;
+}
+
+int64_t primes_bytes(int64_t max_prime)
+{
+  int64_t bytes = 8;
+  if (max_prime <= std::numeric_limits<uint32_t>::max())
+    bytes = 4;
+
+  return pix_upper(max_prime) * bytes;
+}
+
+/// Sieve array of the D and S2_hard formulas,
+/// see LoadBalancerS2.cpp and Sieve.cpp.
+///
+int64_t sieve_bytes(int64_t sieve_limit, int64_t z, int threads)
+{
+  int64_t bytes = L1D_CACHE_SIZE * 2;
+  bytes = min(bytes, get_thread_memory(threads));
+  bytes = max(bytes, isqrt(sieve_limit) / 30);
+
+  // Sieve::wheel_ (8 bytes per sieving prime)
+  int64_t wheel_bytes = pix_upper(isqrt(z)) * 8;
+
+  return (bytes + wheel_bytes) * threads;
+}
+
+/// SegmentedPiTable of the AC formula,
+/// see LoadBalancerAC.cpp.
+///
+int64_t segmented_pi_bytes(int threads)
+{
+  int64_t bytes = L2_CACHE_SIZE;
+  bytes = min(bytes, get_thread_memory(threads));
+  return bytes * threads;
+}
+
+/// Smallest y supported by the Deleglise-Rivat and
+/// Gourdon algorithms, y > x^(1/3). Additionally x / y
+/// must not exceed 62 bits, see get_max_x(alpha_y).
+///
+int64_t get_min_y(maxint_t x)
+{
+  int64_t min_y = (int64_t) iroot<3>(x) + 1;
+  int64_t min_y2 = (int64_t) (x >> 62) + 1;
+  return max(min_y, min_y2);
+}
+
+/// Decrease n by about 6%
+int64_t decrease(int64_t n, int64_t min_n)
+{
+  return max(min_n, n - n / 16 - 1);
+}
+
+void memory_error(int64_t bytes)
+{
+  int64_t mib = ceil_div(bytes, 1 << 20);
+  throw primecount_error("pi(x): the memory limit is too small, at least " +
+                         std::to_string(mib) + " MiB of memory are needed");
+}
+
+/// Used to calibrate the run time model, takes about
+/// 0.1 seconds using a single thread on a 2022 CPU.
+const int64_t calibration_x = (int64_t) 1e13;
+
+std::string format_bytes(int64_t bytes)
+{
+  const char* units[] = { "bytes", "KiB", "MiB", "GiB", "TiB" };
+  double size = (double) bytes;
+  int i = 0;
+
+  for (; size >= 1024 && i < 4; i++)
+    size /= 1024;
+
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(i ? 2 : 0) << size << " " << units[i];
+  return oss.str();
+}
+
+std::string format_seconds(double seconds)
+{
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(2) << seconds << " sec";
+
+  if (seconds >= 86400)
+    oss << " (" << std::setprecision(1) << seconds / 86400 << " days)";
+  else if (seconds >= 3600)
+    oss << " (" << std::setprecision(1) << seconds / 3600 << " hours)";
+
+  return oss.str();
+}
+
+void print_bytes(const std::string& str, int64_t bytes)
+{
+  std::cout << str << " = " << format_bytes(bytes) << std::endl;
+}
+
+/// The Deleglise-Rivat and Gourdon algorithms run in
+/// O(x^(2/3) / (log x)^2) operations.
+///
+double complexity(maxint_t x)
+{
+  double n = max((double) x, 10.0);
+  return std::pow(n, 2.0 / 3.0) / std::pow(std::log(n), 2);
+}
+
+/// Time pi(calibration_x) using a single thread. Backups,
+/// sharding and the memory limit are disabled for the
+/// calibration run and restored afterwards.
+///
+template <typename F>
+double calibrate(F pi_calibration)
+{
+  std::string backup_file = get_backup_file();
+  bool resume = is_resume();
+  int shard = get_shard();
+  int shards = get_shards();
+  std::size_t max_memory = get_max_memory();
+
+  set_backup_file("");
+  set_resume(false);
+  set_shard(0, 1);
+  set_max_memory(0);
+
+  double time = get_time();
+  pi_calibration(calibration_x);
+  time = get_time() - time;
+
+  set_backup_file(backup_file);
+  set_resume(resume);
+  set_shard(shard, shards);
+  set_max_memory(max_memory);
+
+  return time;
+}
+
+/// Estimate the run time of pi(x) by scaling the
+/// measured run time of pi(calibration_x).
+///
+void print_run_time(maxint_t x,
+                    int threads,
+                    const std::string& algorithm,
+                    double calibration_time)
+{
+  double seconds = calibration_time * complexity(x) / complexity(calibration_x);
+
+  std::cout << "Run time (estimated):" << std::endl;
+  std::cout << "Calibration: " << algorithm << "(" << calibration_x << ") = "
+            << format_seconds(calibration_time) << " using 1 thread" << std::endl;
+  std::cout << "Model: time ~ x^(2/3) / log(x)^2" << std::endl;
+  std::cout << "1 thread = " << format_seconds(seconds) << std::endl;
+
+  if (threads > 1)
+    std::cout << threads << " threads = " << format_seconds(seconds / threads)
+              << " (assuming linear scaling)" << std::endl;
+}
+
+} // namespace
+
+namespace primecount {
+
+/// Returns the maximum number of bytes each thread may use
+/// for its thread-local data structures (sieve arrays,
+/// caches). 1/8 of the memory limit is reserved for the
+/// thread-local data structures. If there is no memory
+/// limit the max int64_t value is returned.
+///
+int64_t get_thread_memory(int threads)
+{
+  int64_t max_memory = (int64_t) get_max_memory();
+  if (max_memory <= 0)
+    return std::numeric_limits<int64_t>::max();
+
+  threads = max(threads, 1);
+  return max(max_memory / 8 / threads, (int64_t) 1);
+}
+
+/// Estimated peak memory usage (in bytes) of
+/// pi_gourdon(x) = A - B + C + D + Phi0 + Sigma.
+/// The AC and D formulas use the most memory.
+/// is_print must be the flag passed to pi_gourdon(x) as it
+/// decides whether AC and D are computed concurrently.
+///
+int64_t memory_usage_gourdon(maxint_t x,
+                             int64_t y,
+                             int64_t z,
+                             int threads,
+                             bool is_print)
+{
+  int64_t x_star = get_x_star_gourdon(x, y);
+  int64_t max_a_prime = (int64_t) isqrt(x / x_star);
+  int64_t max_prime = max(max_a_prime, y);
+  int64_t xz = (int64_t) (x / max(z, 1));
+
+  // When computed concurrently the AC and D formulas
+  // are alive at the same time and share the PiTable
+  // and the primes, see pi_gourdon.cpp.
+  if (is_concurrent(x, threads, is_print))
+  {
+    int threads_d = concurrent_threads(threads, 0.55);
+    return pi_table_bytes(max(z, max_a_prime)) +
+           primes_bytes(max_prime) +
+           segmented_pi_bytes(threads - threads_d) +
+           factor_table_bytes(z) +
+           sieve_bytes(xz, z, threads_d);
+  }
+
+  int64_t ac = pi_table_bytes(max(z, max_a_prime)) +
+               primes_bytes(max_prime) +
+               segmented_pi_bytes(threads);
+
+  int64_t d = factor_table_bytes(z) +
+              primes_bytes(y) +
+              pi_table_bytes(y) +
+              sieve_bytes(xz, z, threads);
+
+  return max(ac, d);
+}
+
+/// Estimated peak memory usage (in bytes) of
+/// pi_deleglise_rivat(x) = S1 + S2 + pi(y) - 1 - P2,
+/// with z = x / y. The S2_hard formula uses the
+/// most memory.
+///
+int64_t memory_usage_deleglise_rivat(maxint_t x,
+                                     int64_t y,
+                                     int threads)
+{
+  int64_t z = (int64_t) (x / max(y, 1));
+
+  return factor_table_bytes(y) +
+         primes_bytes(y) +
+         pi_table_bytes(y) +
+         sieve_bytes(z, z, threads);
+}
+
+/// If the user has set a memory limit, decrease z and y
+/// until the estimated memory usage of pi_gourdon(x) is
+/// below the memory limit. Throws a primecount_error if
+/// this is not possible.
+///
+void fit_max_memory_gourdon(maxint_t x,
+                            int64_t& y,
+                            int64_t& z,
+                            int threads,
+                            bool is_print)
+{
+  int64_t max_memory = (int64_t) get_max_memory();
+  if (max_memory <= 0)
+    return;
+
+  int64_t min_y = min(get_min_y(x), y);
+
+  // Decreasing z reduces the size of FactorTableD(z)
+  // and PiTable(z), afterwards we decrease y.
+  while (z > y && memory_usage_gourdon(x, y, z, threads, is_print) > max_memory)
+    z = decrease(z, y);
+
+  while (y > min_y && memory_usage_gourdon(x, y, z, threads, is_print) > max_memory)
+  {
+    y = decrease(y, min_y);
+    z = y;
+  }
+
+  int64_t bytes = memory_usage_gourdon(x, y, z, threads, is_print);
+  if (bytes > max_memory)
+    memory_error(bytes);
+}
+
+/// If the user has set a memory limit, decrease y
+/// until the estimated memory usage of
+/// pi_deleglise_rivat(x) is below the memory limit.
+/// Throws a primecount_error if this is not possible.
+///
+void fit_max_memory_deleglise_rivat(maxint_t x,
+                                    int64_t& y,
+                                    int threads)
+{
+  int64_t max_memory = (int64_t) get_max_memory();
+  if (max_memory <= 0)
+    return;
+
+  int64_t min_y = min(get_min_y(x), y);
+
+  while (y > min_y && memory_usage_deleglise_rivat(x, y, threads) > max_memory)
+    y = decrease(y, min_y);
+
+  int64_t bytes = memory_usage_deleglise_rivat(x, y, threads);
+  if (bytes > max_memory)
+    memory_error(bytes);
+}
+
+/// primecount --dry-run: print the parameters, the estimated
+/// memory usage of the AC and D formulas and the estimated run
+/// time of pi_gourdon(x) without computing pi(x).
+///
+void dry_run_gourdon(maxint_t x, int threads)
+{
+  auto alpha = get_alpha_gourdon(x);
+  maxint_t limit = get_max_x(alpha.first);
+
+  if (x > limit)
+    throw primecount_error("pi(x): x must be <= " + to_string(limit));
+
+  auto yz = get_yz_gourdon(x);
+  int64_t y = yz.first;
+  int64_t z = yz.second;
+  int64_t k = PhiTiny::get_k(x);
+  fit_max_memory_gourdon(x, y, z, threads, is_print());
+
+  int64_t x_star = get_x_star_gourdon(x, y);
+  int64_t max_a_prime = (int64_t) isqrt(x / x_star);
+  int64_t max_prime = max(max_a_prime, y);
+  int64_t xz = (int64_t) (x / z);
+
+  std::cout << "=== Dry run: pi_gourdon(x) ===" << std::endl;
+  print_gourdon(x, y, z, k, threads);
+  std::cout << std::endl;
+
+  std::cout << "Memory usage (estimated):" << std::endl;
+  print_bytes("AC: PiTable(max(z, x_star^(1/2)))", pi_table_bytes(max(z, max_a_prime)));
+  print_bytes("AC: primes", primes_bytes(max_prime));
+  print_bytes("AC: SegmentedPiTable per thread", segmented_pi_bytes(threads) / threads);
+  print_bytes("D: FactorTableD(z)", factor_table_bytes(z));
+  print_bytes("D: PiTable(y)", pi_table_bytes(y));
+  print_bytes("D: primes", primes_bytes(y));
+  print_bytes("D: Sieve per thread", sieve_bytes(xz, z, threads) / threads);
+  print_bytes("Peak memory usage", memory_usage_gourdon(x, y, z, threads, is_print()));
+
+  if (get_max_memory() > 0)
+    print_bytes("Memory limit", get_max_memory());
+
+  std::cout << std::endl;
+  double time = calibrate([&](int64_t n) { return pi_gourdon_64(n, 1, false); });
+  print_run_time(x, threads, "pi_gourdon", time);
+}
+
+/// primecount --dry-run: print the parameters, the estimated
+/// memory usage of the S2_hard formula and the estimated run
+/// time of pi_deleglise_rivat(x) without computing pi(x).
+///
+void dry_run_deleglise_rivat(maxint_t x, int threads)
+{
+  double alpha = get_alpha_deleglise_rivat(x);
+  maxint_t limit = get_max_x(alpha);
+
+  if (x > limit)
+    throw primecount_error("pi(x): x must be <= " + to_string(limit));
+
+  int64_t y = get_y_deleglise_rivat(x);
+  fit_max_memory_deleglise_rivat(x, y, threads);
+  int64_t z = (int64_t) (x / max(y, 1));
+  int64_t c = PhiTiny::get_c(y);
+
+  std::cout << "=== Dry run: pi_deleglise_rivat(x) ===" << std::endl;
+  print(x, y, z, c, threads);
+  std::cout << std::endl;
+
+  std::cout << "Memory usage (estimated):" << std::endl;
+  print_bytes("S2_hard: FactorTable(y)", factor_table_bytes(y));
+  print_bytes("S2_hard: PiTable(y)", pi_table_bytes(y));
+  print_bytes("S2_hard: primes", primes_bytes(y));
+  print_bytes("S2_hard: Sieve per thread", sieve_bytes(z, z, threads) / threads);
+  print_bytes("Peak memory usage", memory_usage_deleglise_rivat(x, y, threads));
+
+  if (get_max_memory() > 0)
+    print_bytes("Memory limit", get_max_memory());
+
+  std::cout << std::endl;
+  double time = calibrate([&](int64_t n) { return pi_deleglise_rivat_64(n, 1, false); });
+  print_run_time(x, threads, "pi_deleglise_rivat", time);
+}
+
+} // namespace
@@ -12,12 +12,20 @@
 #include <primecount-internal.hpp>
 #include <primesieve.hpp>
 #include <PiTable.hpp>
+#include <ResultCache.hpp>
 #include <pod_vector.hpp>
 #include <imath.hpp>
 #include <macros.hpp>
+#include <min.hpp>
 
 #include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <numeric>
 #include <string>
+#include <vector>
 
 using namespace primecount;
 
@@ -69,6 +77,83 @@ int64_t binary_search_nth_prime(int64_t n)
   return low;
 }
 
+/// Approximation of the nth prime
+int64_t nth_prime_approx(int64_t n)
+{
+  // Li_inverse(x) is faster but less accurate than Ri_inverse(x).
+  // For small n speed is more important than accuracy.
+  if (n < 1e8)
+    return Li_inverse(n);
+  else
+    return Ri_inverse(n);
+}
+
+void check_nth_prime(int64_t n)
+{
+  if_unlikely(n < 1)
+    throw primecount_error("nth_prime(n): n must be >= 1");
+  if_unlikely(n > max_n)
+    throw primecount_error("nth_prime(n): n must be <= " + std::to_string(max_n));
+}
+
+/// Find the nth prime using pi(low) = count. As long as
+/// we are far from the nth prime we count the primes
+/// inside the gap using multiple threads, for the last
+/// few primes we iterate over the primes one by one.
+///
+int64_t nth_prime_sieve(int64_t n,
+                        int64_t low,
+                        int64_t count,
+                        int threads)
+{
+  // For small distances iterating over the
+  // primes is faster than counting in parallel.
+  const int64_t max_iterate = 100000;
+
+  while (std::abs(n - count) > max_iterate)
+  {
+    int64_t avg_prime_gap = (int64_t) std::log((double) low);
+    int64_t dist = (n - count) * avg_prime_gap;
+
+    if (dist > 0)
+    {
+      dist = min(dist, std::numeric_limits<int64_t>::max() - low);
+      count += count_primes_sieve(low + 1, low + dist, threads);
+    }
+    else
+    {
+      dist = max(dist, -low);
+      count -= count_primes_sieve(low + dist + 1, low, threads);
+    }
+
+    low += dist;
+  }
+
+  int64_t avg_prime_gap = ilog(low) + 2;
+  int64_t prime = -1;
+
+  // Here we are very close to the nth prime < sqrt(nth_prime),
+  // we simply iterate over the primes until we find it.
+  if (count < n)
+  {
+    uint64_t start = low + 1;
+    uint64_t stop = start + (n - count) * avg_prime_gap;
+    primesieve::iterator iter(start, stop);
+    for (int64_t i = count; i < n; i++)
+      prime = iter.next_prime();
+  }
+  else // if (count >= n)
+  {
+    uint64_t start = low;
+    uint64_t stop = start - (count - n) * avg_prime_gap;
+    primesieve::iterator iter(start, stop);
+    for (int64_t i = count; i + 1 > n; i--)
+      prime = iter.prev_prime();
+  }
+
+  return prime;
+}
+
 } // namespace
 
 namespace primecount {
@@ -80,10 +165,7 @@ namespace primecount {
 ///
 int64_t nth_prime(int64_t n, int threads)
 {
-  if_unlikely(n < 1)
-    throw primecount_error("nth_prime(n): n must be >= 1");
-  if_unlikely(n > max_n)
-    throw primecount_error("nth_prime(n): n must be <= " + std::to_string(max_n));
+  check_nth_prime(n);
 
   // For tiny n <= 169
   if (n < (int64_t) primes.size())
@@ -93,41 +175,70 @@ int64_t nth_prime(int64_t n, int threads)
   if (n <= PiTable::pi_cache(PiTable::max_cached()))
     return binary_search_nth_prime(n);
 
-  int64_t prime_approx;
+  int64_t prime_approx = nth_prime_approx(n);
 
-  // Li_inverse(x) is faster but less accurate than Ri_inverse(x).
-  // For small n speed is more important than accuracy.
-  if (n < 1e8)
-    prime_approx = Li_inverse(n);
-  else
-    prime_approx = Ri_inverse(n);
+  // Repeated queries are answered by the result cache
+  std::string key = "nth_prime(" + std::to_string(n) + ")";
+  std::string value;
+  bool is_cache = prime_approx >= min_cached_x;
+  if (is_cache && get_cached_result(key, value))
+    return (int64_t) to_maxint(value);
 
   // For large n we use the prime counting function
   // and the segmented sieve of Eratosthenes.
   int64_t count_approx = pi(prime_approx, threads);
-  int64_t avg_prime_gap =  ilog(prime_approx) + 2;
-  int64_t prime = -1;
+  int64_t prime = nth_prime_sieve(n, prime_approx, count_approx, threads);
 
-  // Here we are very close to the nth prime < sqrt(nth_prime),
-  // we simply iterate over the primes until we find it.
-  if (count_approx < n)
-  {
-    uint64_t start = prime_approx + 1;
-    uint64_t stop = start + (n - count_approx) * avg_prime_gap;
-    primesieve::iterator iter(start, stop);
-    for (int64_t i = count_approx; i < n; i++)
-      prime = iter.next_prime();
-  }
-  else // if (count_approx >= n)
+  if (is_cache)
+    set_cached_result(key, std::to_string(prime));
+
+  return prime;
+}
+
+std::vector<int64_t> nth_prime_batch(const std::vector<int64_t>& n)
+{
+  return nth_prime_batch(n, get_num_threads());
+}
+
+/// Find the nth prime for many n values. Only the first
+/// nth prime is computed using the prime counting function,
+/// for the following n values we count the primes inside
+/// the gap from the previous nth prime as long as this is
+/// faster than computing pi(x) from scratch.
+///
+std::vector<int64_t> nth_prime_batch(const std::vector<int64_t>& n, int threads)
+{
+  for (int64_t i : n)
+    check_nth_prime(i);
+
+  std::vector<int64_t> res(n.size());
+  std::vector<std::size_t> idx(n.size());
+  std::iota(idx.begin(), idx.end(), 0);
+  std::sort(idx.begin(), idx.end(),
+    [&](std::size_t a, std::size_t b) { return n[a] < n[b]; });
+
+  int64_t prev_n = 0;
+  int64_t prev_prime = 0;
+
+  for (std::size_t i : idx)
   {
-    uint64_t start = prime_approx;
-    uint64_t stop = start - (count_approx - n) * avg_prime_gap;
-    primesieve::iterator iter(start, stop);
-    for (int64_t i = count_approx; i + 1 > n; i--)
-      prime = iter.prev_prime();
+    if (n[i] != prev_n)
+    {
+      int64_t prime_approx = nth_prime_approx(n[i]);
+
+      if (prev_n > PiTable::pi_cache(PiTable::max_cached()) &&
+          is_sieve_gap(prev_prime, prime_approx))
+        prev_prime = nth_prime_sieve(n[i], prev_prime, prev_n, threads);
+      else
+        prev_prime = nth_prime(n[i], threads);
+
+      prev_n = n[i];
+    }
+
+    res[i] = prev_prime;
   }
 
-  return prime;
+  return res;
 }
 
 } // namespace
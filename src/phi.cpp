@@ -23,6 +23,7 @@
 ///
 
 #include <primecount-internal.hpp>
+#include <primecount-config.hpp>
 #include <BitSieve240.hpp>
 #include <generate.hpp>
 #include <fast_div.hpp>
@@ -34,60 +35,263 @@
 #include <print.hpp>
 #include <pod_vector.hpp>
 #include <popcnt.hpp>
+#include <ResultCache.hpp>
 
 #include <stdint.h>
 #include <algorithm>
 #include <cmath>
+#include <string>
 #include <utility>
 
 using namespace primecount;
 
 namespace {
 
+/// Packing sieve_t increases the cache's capacity by 25%
+/// which improves performance by up to 10%.
+#pragma pack(push, 1)
+struct sieve_t
+{
+  uint32_t count;
+  uint64_t bits;
+};
+#pragma pack(pop)
+
+/// We cache phi(x, a) if a <= max_a.
+/// The value max_a = 100 has been determined empirically
+/// by running benchmarks. Using a smaller or larger
+/// max_a with the same amount of memory (max_megabytes)
+/// decreases the performance.
+///
+uint64_t get_max_a(uint64_t a)
+{
+  uint64_t max_a = 100;
+
+  // Make sure we cache only frequently used values
+  a = a - min(a, 30);
+  return min(a, max_a);
+}
+
+/// We cache phi(x, a) if x <= max_x.
+/// The value max_x = x^(1/2.3) has been determined by running
+/// pi_legendre(x) benchmarks from 1e10 to 1e16. On systems
+/// with few CPU cores max_x = sqrt(x) tends to perform better
+/// but this causes scaling issues on big servers. Returns
+/// the number of sieve_t elements per cache level.
+///
+uint64_t get_max_x_size(uint64_t x, uint64_t indexes, uint64_t max_bytes)
+{
+  uint64_t max_x = (uint64_t) std::pow(x, 1 / 2.3);
+  uint64_t max_bytes_per_index = max_bytes / indexes;
+  uint64_t numbers_per_byte = 240 / sizeof(sieve_t);
+  uint64_t cache_limit = max_bytes_per_index * numbers_per_byte;
+  max_x = min(max_x, cache_limit);
+  uint64_t max_x_size = ceil_div(max_x, 240);
+
+  // For tiny computations caching is not worth it
+  if (max_x_size < 8)
+    return 0;
+
+  return max_x_size;
+}
+
+/// The phi(x, i) cache levels with small i are used by all
+/// threads. Instead of computing these levels in each thread
+/// we compute them once (in parallel) and all threads access
+/// them read-only. The memory usage of the shared levels is
+/// limited by the size of the CPU's last level cache.
+///
+class PhiCacheShared : public BitSieve240
+{
+public:
+  PhiCacheShared(uint64_t x,
+                 uint64_t a,
+                 const pod_vector<int32_t>& primes,
+                 int threads)
+  {
+    uint64_t max_a = get_max_a(a);
+
+    if (max_a <= PhiTiny::max_a())
+      return;
+
+    // The lower half of the cache levels is shared,
+    // the upper half is stored in each thread's PhiCache.
+    uint64_t indexes = ceil_div(max_a - PhiTiny::max_a(), 2);
+    uint64_t max_bytes = LLC_CACHE_SIZE;
+    max_bytes = min(max_bytes, get_thread_memory(1) / 2);
+    max_x_size_ = get_max_x_size(x, indexes, max_bytes);
+
+    if (max_x_size_ == 0)
+      return;
+
+    // Make sure that there are no uninitialized
+    // bits in the last sieve array element.
+    max_x_ = max_x_size_ * 240 - 1;
+    max_a_ = PhiTiny::max_a() + indexes;
+    init_cache(primes, threads);
+  }
+
+  /// Returns 0 if there are no shared cache levels
+  uint64_t max_a() const
+  {
+    return max_a_;
+  }
+
+  uint64_t max_x_size() const
+  {
+    return max_x_size_;
+  }
+
+  bool is_cached(uint64_t x, uint64_t a) const
+  {
+    return x <= max_x_ &&
+           a <= max_a_ &&
+           a > PhiTiny::max_a();
+  }
+
+  const sieve_t* sieve(uint64_t a) const
+  {
+    ASSERT(a > PhiTiny::max_a());
+    ASSERT(a <= max_a_);
+    return sieve_[a].data();
+  }
+
+private:
+  /// The sieve array is split into chunks that are sieved in
+  /// parallel. Each thread removes the first max_a primes and
+  /// their multiples from its chunk (for all cache levels).
+  /// Afterwards the cumulative 1 bit counts of the chunks
+  /// are combined.
+  ///
+  void init_cache(const pod_vector<int32_t>& primes, int threads)
+  {
+    uint64_t levels = max_a_ + 1;
+    uint64_t first = PhiTiny::max_a() + 1;
+    sieve_.resize(levels);
+
+    for (uint64_t i = first; i < levels; i++)
+      sieve_[i].resize(max_x_size_);
+
+    // Each chunk must be large enough to
+    // amortize crossing off the primes.
+    int64_t min_chunk_size = 1 << 12;
+    int64_t chunk_size = max(min_chunk_size, ceil_div(max_x_size_, threads));
+    int64_t chunks = ceil_div(max_x_size_, chunk_size);
+    threads = (int) min((int64_t) threads, chunks);
+    pod_vector<uint64_t> counts(levels * chunks);
+
+    #pragma omp parallel for schedule(static) num_threads(threads)
+    for (int64_t j = 0; j < chunks; j++)
+    {
+      uint64_t begin = chunk_size * j;
+      uint64_t end = min(begin + chunk_size, max_x_size_);
+      uint64_t low = begin * 240;
+      uint64_t high = end * 240 - 1;
+      std::fill(&sieve_[first][begin], &sieve_[first][end], sieve_t{0, ~0ull});
+
+      for (uint64_t i = 4; i < levels; i++)
+      {
+        // Initalize phi(x, i) with phi(x, i - 1)
+        sieve_t* sieve = &sieve_[max(i, first)][0];
+        if (i > first)
+          std::copy(&sieve_[i - 1][begin], &sieve_[i - 1][end], &sieve[begin]);
+
+        // Remove prime[i] and its multiples
+        uint64_t prime = primes[i];
+        if (prime >= low && prime <= high)
+          sieve[prime / 240].bits &= unset_bit_[prime % 240];
+
+        uint64_t q = max(ceil_div(low, prime), prime);
+        q += ~q & 1;
+
+        for (uint64_t n = prime * q; n <= high; n += prime * 2)
+          sieve[n / 240].bits &= unset_bit_[n % 240];
+
+        if (i >= first)
+        {
+          // Cumulative 1 bit counts (relative to the chunk)
+          uint64_t count = 0;
+          for (uint64_t k = begin; k < end; k++)
+          {
+            sieve[k].count = (uint32_t) count;
+            count += popcnt64(sieve[k].bits);
+          }
+          counts[i * chunks + j] = count;
+        }
+      }
+    }
+
+    #pragma omp parallel for schedule(static) num_threads(threads)
+    for (int64_t j = 1; j < chunks; j++)
+    {
+      uint64_t begin = chunk_size * j;
+      uint64_t end = min(begin + chunk_size, max_x_size_);
+
+      for (uint64_t i = first; i < levels; i++)
+      {
+        uint64_t count = 0;
+        for (int64_t k = 0; k < j; k++)
+          count += counts[i * chunks + k];
+        for (uint64_t k = begin; k < end; k++)
+          sieve_[i][k].count += (uint32_t) count;
+      }
+    }
+  }
+
+  uint64_t max_x_ = 0;
+  uint64_t max_x_size_ = 0;
+  uint64_t max_a_ = 0;
+
+  /// sieve[a] contains only numbers that are not divisible
+  /// by any of the the first a primes. sieve[a][i].count
+  /// contains the count of numbers < i * 240 that are not
+  /// divisible by any of the first a primes.
+  pod_vector<pod_vector<sieve_t>> sieve_;
+};
+
 class PhiCache : public BitSieve240
 {
 public:
   PhiCache(uint64_t x,
            uint64_t a,
            const pod_vector<int32_t>& primes,
-           const PiTable& pi) :
+           const PiTable& pi,
+           const PhiCacheShared& shared,
+           int threads) :
     primes_(primes),
-    pi_(pi)
+    pi_(pi),
+    shared_(shared)
   {
-    // We cache phi(x, a) if a <= max_a.
-    // The value max_a = 100 has been determined empirically
-    // by running benchmarks. Using a smaller or larger
-    // max_a with the same amount of memory (max_megabytes)
-    // decreases the performance.
-    uint64_t max_a = 100;
+    uint64_t max_a = get_max_a(a);
 
-    // Make sure we cache only frequently used values
-    a = a - min(a, 30);
-    max_a = min(a, max_a);
+    // This thread caches phi(x, a) if a > min_a,
+    // smaller a values are cached by PhiCacheShared.
+    min_a_ = max(PhiTiny::max_a(), shared_.max_a());
+    max_a_cached_ = min_a_;
 
-    if (max_a <= PhiTiny::max_a())
+    if (max_a <= min_a_)
       return;
 
-    // We cache phi(x, a) if x <= max_x.
-    // The value max_x = x^(1/2.3) has been determined by running
-    // pi_legendre(x) benchmarks from 1e10 to 1e16. On systems
-    // with few CPU cores max_x = sqrt(x) tends to perform better
-    // but this causes scaling issues on big servers.
-    uint64_t max_x = (uint64_t) std::pow(x, 1 / 2.3);
-
-    // The cache (i.e. the sieve array)
-    // uses at most max_megabytes per thread.
+    // The cache (i.e. the sieve array) uses at most
+    // max_megabytes per thread. On CPUs with many cores
+    // we reduce the memory usage per thread so that all
+    // threads' caches together roughly fit into the
+    // CPU's last level cache. If the user has set a
+    // memory limit the cache may be even smaller.
     uint64_t max_megabytes = 16;
-    uint64_t indexes = max_a - PhiTiny::max_a();
-    uint64_t max_bytes = max_megabytes << 20;
-    uint64_t max_bytes_per_index = max_bytes / indexes;
-    uint64_t numbers_per_byte = 240 / sizeof(sieve_t);
-    uint64_t cache_limit = max_bytes_per_index * numbers_per_byte;
-    max_x = min(max_x, cache_limit);
-    max_x_size_ = ceil_div(max_x, 240);
-
-    // For tiny computations caching is not worth it
-    if (max_x_size_ < 8)
+    uint64_t max_bytes = LLC_CACHE_SIZE / threads;
+    max_bytes = max(max_bytes, L2_CACHE_SIZE);
+    max_bytes = min(max_bytes, max_megabytes << 20);
+    max_bytes = min(max_bytes, get_thread_memory(threads) / 2);
+    uint64_t indexes = max_a - min_a_;
+    max_x_size_ = get_max_x_size(x, indexes, max_bytes);
+
+    // The first cache level of this thread is
+    // initialized using the shared cache levels.
+    if (shared_.max_a() > PhiTiny::max_a())
+      max_x_size_ = min(max_x_size_, shared_.max_x_size());
+
+    if (max_x_size_ == 0)
       return;
 
     // Make sure that there are no uninitialized
@@ -120,6 +324,8 @@ public:
     int64_t sum;
     int64_t c = PhiTiny::max_a();
     int64_t larger_c = min(max_a_cached_, a);
+    if (!is_cached(x, larger_c))
+      larger_c = min(shared_.max_a(), a);
     larger_c = std::max(c, larger_c);
     ASSERT(c < a);
 
@@ -197,16 +403,20 @@ private:
 
   bool is_cached(uint64_t x, uint64_t a) const
   {
+    if (a <= shared_.max_a())
+      return shared_.is_cached(x, a);
+
     return x <= max_x_ &&
            a <= max_a_cached_ &&
-           a > PhiTiny::max_a();
+           a > min_a_;
   }
 
   int64_t phi_cache(uint64_t x, uint64_t a) const
   {
     ASSERT(is_cached(x, a));
-    uint64_t count = sieve_[a][x / 240].count;
-    uint64_t bits = sieve_[a][x / 240].bits;
+    const sieve_t* sieve = (a <= shared_.max_a()) ? shared_.sieve(a) : sieve_[a].data();
+    uint64_t count = sieve[x / 240].count;
+    uint64_t bits = sieve[x / 240].bits;
     uint64_t bitmask = unset_larger_[x % 240];
     return count + popcnt64(bits & bitmask);
   }
@@ -221,16 +431,27 @@ private:
   ///
   void init_cache(uint64_t a)
   {
-    ASSERT(a > PhiTiny::max_a());
+    ASSERT(a > min_a_);
     ASSERT(a <= max_a_);
 
     if (sieve_.empty())
     {
       ASSERT(max_a_ >= 3);
       sieve_.resize(max_a_ + 1);
-      sieve_[3].resize(max_x_size_);
-      std::fill(sieve_[3].begin(), sieve_[3].end(), sieve_t{0, ~0ull});
-      max_a_cached_ = 3;
+
+      if (min_a_ == shared_.max_a())
+      {
+        // Initialize using the largest shared cache level
+        const sieve_t* sieve = shared_.sieve(min_a_);
+        sieve_[min_a_].resize(max_x_size_);
+        std::copy(sieve, sieve + max_x_size_, sieve_[min_a_].begin());
+      }
+      else
+      {
+        sieve_[3].resize(max_x_size_);
+        std::fill(sieve_[3].begin(), sieve_[3].end(), sieve_t{0, ~0ull});
+        max_a_cached_ = 3;
+      }
     }
 
     uint64_t i = max_a_cached_ + 1;
@@ -240,7 +461,7 @@ private:
     for (; i <= a; i++)
     {
       // Initalize phi(x, i) with phi(x, i - 1)
-      if (i - 1 <= PhiTiny::max_a())
+      if (i - 1 <= min_a_)
         sieve_[i] = std::move(sieve_[i - 1]);
       else
       {
@@ -276,18 +497,9 @@ private:
   uint64_t max_x_ = 0;
   uint64_t max_x_size_ = 0;
   uint64_t max_a_cached_ = 0;
+  uint64_t min_a_ = 0;
   uint64_t max_a_ = 0;
 
-  /// Packing sieve_t increases the cache's capacity by 25%
-  /// which improves performance by up to 10%.
-  #pragma pack(push, 1)
-  struct sieve_t
-  {
-    uint32_t count;
-    uint64_t bits;
-  };
-  #pragma pack(pop)
-
   /// sieve[a] contains only numbers that are not divisible
   /// by any of the the first a primes. sieve[a][i].count
   /// contains the count of numbers < i * 240 that are not
@@ -295,6 +507,7 @@ private:
   pod_vector<pod_vector<sieve_t>> sieve_;
   const pod_vector<int32_t>& primes_;
   const PiTable& pi_;
+  const PhiCacheShared& shared_;
 };
 
 /// If a is very large (i.e. prime[a] > sqrt(x)) then we need to
@@ -385,11 +598,16 @@ int64_t phi_OpenMP(int64_t x, int64_t a, int threads)
   threads = std::min(threads, max_threads);
   threads = ideal_num_threads(x, threads, thread_threshold);
 
+  // The small cache levels are computed once
+  // and shared read-only by all threads.
+  PhiCacheShared shared(x, a, primes, threads);
+
   #pragma omp parallel num_threads(threads) reduction(+: sum)
   {
-    // Each thread uses its own PhiCache object in
-    // order to avoid thread synchronization.
-    PhiCache cache(x, a, primes, pi);
+    // Each thread uses its own PhiCache object (for the
+    // larger cache levels) in order to avoid thread
+    // synchronization.
+    PhiCache cache(x, a, primes, pi, shared, threads);
 
     #pragma omp for nowait schedule(dynamic, 16)
     for (int64_t i = c + 1; i <= a; i++)
@@ -421,7 +639,15 @@ int64_t phi(int64_t x,
     time = get_time();
   }
 
-  int64_t sum = phi_OpenMP(x, a, threads);
+  int64_t sum;
+
+  if (x < min_cached_x)
+    sum = phi_OpenMP(x, a, threads);
+  else
+  {
+    std::string key = "phi(" + std::to_string(x) + ", " + std::to_string(a) + ")";
+    sum = cached_result<int64_t>(key, [&] { return phi_OpenMP(x, a, threads); });
+  }
 
   if (is_print)
     print("phi", sum, time);
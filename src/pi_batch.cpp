@@ -0,0 +1,196 @@
+///
+/// @file  pi_batch.cpp
+/// @brief Count the primes <= x for many x values. The x values
+///        are sorted and for each x we decide whether it is
+///        cheaper to compute pi(x) from scratch using the prime
+///        counting function or to count the primes inside the gap
+///        ]previous x, x] using the segmented sieve of
+///        Eratosthenes, see is_sieve_gap() in pi_from.cpp.
+///
+///        All gaps are split into chunks that are sieved in
+///        parallel. Small pi(x) computations (that do not scale
+///        well to many threads) are computed in parallel using a
+///        single thread each, large pi(x) computations are
+///        computed one after the other using all threads.
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <primecount.hpp>
+#include <primecount-internal.hpp>
+#include <primesieve.hpp>
+#include <PiTable.hpp>
+#include <imath.hpp>
+#include <min.hpp>
+
+#include <stdint.h>
+#include <algorithm>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+using namespace primecount;
+
+namespace {
+
+/// pi(x) computations with x below this threshold do not
+/// scale well to many threads, we compute them in parallel
+/// using a single thread each.
+const int64_t small_x = (int64_t) 1e10;
+
+/// Sieving interval [low, high] which spans the gaps
+/// j, j + 1, ... with gap j = ]xs[j - 1], xs[j]].
+struct Chunk
+{
+  int64_t low;
+  int64_t high;
+  std::size_t j;
+  // counts[i] = primes of gap j + i inside [low, high]
+  std::vector<int64_t> counts;
+};
+
+/// Count the primes inside [low, high] and
+/// add them to the gap they belong to.
+///
+void count_chunk(Chunk& chunk, const std::vector<int64_t>& xs)
+{
+  primesieve::iterator it(chunk.low, chunk.high);
+  uint64_t prime = it.next_prime();
+  std::size_t i = 0;
+
+  for (; prime <= (uint64_t) chunk.high; prime = it.next_prime())
+  {
+    while ((int64_t) prime > xs[chunk.j + i])
+      i++;
+    chunk.counts[i]++;
+  }
+}
+
+} // namespace
+
+namespace primecount {
+
+std::vector<int64_t> pi_batch(const std::vector<int64_t>& x)
+{
+  return pi_batch(x, get_num_threads());
+}
+
+std::vector<int64_t> pi_batch(const std::vector<int64_t>& x, int threads)
+{
+  std::vector<int64_t> res(x.size(), 0);
+  std::vector<std::size_t> idx(x.size());
+  std::iota(idx.begin(), idx.end(), 0);
+  std::sort(idx.begin(), idx.end(),
+    [&](std::size_t a, std::size_t b) { return x[a] < x[b]; });
+
+  // The distinct x values in ascending order. Each one
+  // is either computed using the prime counting
+  // function or by sieving the gap ]previous x, x].
+  std::vector<int64_t> xs;
+  std::vector<int64_t> pix;
+  std::vector<bool> is_gap;
+  std::vector<std::size_t> large;
+  std::vector<std::size_t> small;
+
+  for (std::size_t i : idx)
+  {
+    if (x[i] < 2 || (!xs.empty() && x[i] == xs.back()))
+      continue;
+
+    std::size_t j = xs.size();
+    bool gap = !xs.empty() && is_sieve_gap(xs.back(), x[i]);
+    xs.push_back(x[i]);
+    pix.push_back(0);
+    is_gap.push_back(gap);
+
+    if (!gap)
+    {
+      if (x[i] <= PiTable::max_cached())
+        pix[j] = PiTable::pi_cache(x[i]);
+      else if (x[i] < small_x)
+        small.push_back(j);
+      else
+        large.push_back(j);
+    }
+  }
+
+  // Consecutive gaps are sieved together, we split
+  // them into chunks that are large enough to amortize
+  // the initialization of the sieve (sieving primes
+  // <= sqrt(high)) and small enough to keep all
+  // threads busy.
+  std::vector<Chunk> chunks;
+
+  for (std::size_t j = 1; j < xs.size(); j++)
+  {
+    if (!is_gap[j] || is_gap[j - 1])
+      continue;
+
+    std::size_t last = j;
+    while (last + 1 < xs.size() && is_gap[last + 1])
+      last++;
+
+    int64_t low = xs[j - 1] + 1;
+    int64_t high = xs[last];
+    int64_t min_size = max((int64_t) 1 << 26, isqrt(high) * 4);
+    int64_t chunk_size = max(min_size, ceil_div(high - low + 1, threads * 8));
+
+    while (true)
+    {
+      Chunk chunk;
+      chunk.low = low;
+      chunk.high = (high - low < chunk_size) ? high : low + chunk_size - 1;
+      chunk.j = std::lower_bound(xs.begin(), xs.end(), chunk.low) - xs.begin();
+      std::size_t k = std::lower_bound(xs.begin(), xs.end(), chunk.high) - xs.begin();
+      chunk.counts.resize(k - chunk.j + 1, 0);
+      chunks.push_back(std::move(chunk));
+      if (high - low < chunk_size)
+        break;
+      low += chunk_size;
+    }
+  }
+
+  int64_t chunks_size = chunks.size();
+  int64_t small_size = small.size();
+
+  #pragma omp parallel num_threads(threads)
+  {
+    #pragma omp for schedule(dynamic) nowait
+    for (int64_t i = 0; i < chunks_size; i++)
+      count_chunk(chunks[i], xs);
+
+    #pragma omp for schedule(dynamic)
+    for (int64_t i = 0; i < small_size; i++)
+      pix[small[i]] = pi_noprint(xs[small[i]], 1);
+  }
+
+  for (std::size_t j : large)
+    pix[j] = pi_noprint(xs[j], threads);
+
+  std::vector<int64_t> gap_count(xs.size(), 0);
+  for (const Chunk& chunk : chunks)
+    for (std::size_t i = 0; i < chunk.counts.size(); i++)
+      gap_count[chunk.j + i] += chunk.counts[i];
+
+  // pi(x) = pi(previous x) + primes inside ]previous x, x]
+  for (std::size_t j = 0; j < xs.size(); j++)
+    if (is_gap[j])
+      pix[j] = pix[j - 1] + gap_count[j];
+
+  for (std::size_t i = 0, j = 0; i < idx.size(); i++)
+  {
+    int64_t n = x[idx[i]];
+    if (n < 2)
+      continue;
+    while (xs[j] != n)
+      j++;
+    res[idx[i]] = pix[j];
+  }
+
+  return res;
+}
+
+} // namespace
@@ -0,0 +1,408 @@
+///
+/// @file  pi_from.cpp
+/// @brief Compute pi(x2) using a known pi(x1) with x1 close to
+///        x2. If the gap between x1 and x2 is small it is much
+///        faster to count the primes inside the gap using the
+///        segmented sieve of Eratosthenes than to compute pi(x2)
+///        from scratch using Gourdon's algorithm.
+///
+///        In order to decide which of the two methods is faster
+///        we use a cost model based on benchmarks of primesieve
+///        and pi_gourdon(x) for x = 10^8, 10^9, ..., 10^18.
+///
+///        count_primes(a, b) uses the same cost model to decide
+///        whether the primes inside [a, b] are counted using the
+///        sieve of Eratosthenes or using pi(b) - pi(a - 1).
+///        primesieve only supports numbers < 2^64, above we
+///        use our own (slower) 128-bit segmented sieve.
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <primecount.hpp>
+#include <primecount-internal.hpp>
+#include <primesieve.hpp>
+#include <imath.hpp>
+#include <min.hpp>
+#include <pod_vector.hpp>
+#include <print.hpp>
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace primecount;
+
+namespace {
+
+/// Sieving a gap of size break_even[i] using primesieve takes
+/// about as long as computing pi(10^(i+8)) using Gourdon's
+/// algorithm. Both have been benchmarked using a single
+/// thread on an x64 CPU, the pi(10^18) entry has been
+/// extrapolated.
+///
+const pod_array<double, 11> break_even =
+{
+  6.9e5, 3.1e6, 8.6e6, 2.8e7, 7.7e7, 2.5e8,
+  6.8e8, 2.3e9, 9.3e9, 3.2e10, 1.2e11
+};
+
+/// Run time of the prime counting function
+double pi_complexity(double x)
+{
+  double logx = std::log(x);
+  return std::pow(x, 2.0 / 3.0) / (logx * logx);
+}
+
+/// Returns the size of the gap whose sieving takes as
+/// long as computing pi(x) using Gourdon's algorithm.
+/// Outside of the benchmarked range we extrapolate
+/// using the run time complexity of pi(x).
+///
+double get_break_even(double x)
+{
+  double log10x = std::log10(max(x, 10.0));
+  double i = log10x - 8;
+  double last = (double) (break_even.size() - 1);
+
+  if (i <= 0)
+    return break_even[0] * pi_complexity(x) / pi_complexity(1e8);
+  if (i >= last)
+    return break_even.back() * pi_complexity(x) / pi_complexity(std::pow(10.0, last + 8));
+
+  // Linear interpolation of log(break_even)
+  std::size_t j = (std::size_t) i;
+  double t = i - (double) j;
+  double log_b = std::log(break_even[j]) * (1 - t) + std::log(break_even[j + 1]) * t;
+  return std::exp(log_b);
+}
+
+/// Count the primes inside [start, stop] using a
+/// primesieve::iterator. Unlike primesieve::count_primes()
+/// this always uses a single thread and does not depend on
+/// primesieve's global number of threads.
+///
+uint64_t count_primes_iterator(uint64_t start, uint64_t stop)
+{
+  primesieve::iterator it(start, stop);
+  it.generate_next_primes();
+  uint64_t count = 0;
+
+  for (; it.primes_[it.size_ - 1] <= stop; it.generate_next_primes())
+    count += it.size_ - it.i_;
+  for (; it.primes_[it.i_] <= stop; it.i_++)
+    count += 1;
+
+  return count;
+}
+
+/// Count the primes inside [low, high] using primesieve.
+/// The interval is split into chunks which are distributed
+/// amongst the threads, each chunk is counted by its
+/// own primesieve::iterator.
+///
+uint64_t count_primesieve(uint64_t low, uint64_t high, int threads)
+{
+  // Each chunk must be large enough to amortize the
+  // initialization of the sieve (sieving primes
+  // <= sqrt(high)), we use the same minimum thread
+  // distance as primesieve.
+  uint64_t dist = high - low;
+  uint64_t min_size = max((uint64_t) 1e7, isqrt(high) / 5);
+  uint64_t chunk_size = max(min_size, ceil_div(dist, (uint64_t) threads * 8));
+  int64_t chunks = (int64_t) (dist / chunk_size + 1);
+  threads = (int) min((int64_t) threads, chunks);
+  uint64_t sum = 0;
+
+  #pragma omp parallel for schedule(dynamic) num_threads(threads) reduction(+: sum)
+  for (int64_t i = 0; i < chunks; i++)
+  {
+    uint64_t start = low + chunk_size * i;
+    uint64_t stop = (high - start < chunk_size) ? high : start + chunk_size - 1;
+    sum += count_primes_iterator(start, stop);
+  }
+
+  return sum;
+}
+
+#ifdef HAVE_INT128_T
+
+/// primesieve only supports numbers < 2^64, above
+/// we sieve the interval in segments of this size.
+///
+constexpr uint64_t max_segment_size = 1 << 22;
+
+/// Cost of our segmented sieve relative to sieving a number
+/// using primesieve: each number costs about 8x more and
+/// each sieving prime costs about 4 numbers per segment
+/// (128-bit modulo). Benchmarked near 10^20.
+///
+constexpr double number_cost = 8;
+constexpr double sieving_prime_cost = 4;
+
+/// Count the primes inside [low, high] for numbers that are
+/// too large for primesieve. In each segment we cross off
+/// the multiples of the sieving primes <= sqrt(high). The
+/// sieving primes are distributed amongst the threads,
+/// each thread uses its own sieve array.
+///
+uint64_t count_primes_segmented(uint128_t low, uint128_t high, int threads)
+{
+  uint64_t sqrt_high = (uint64_t) isqrt(high);
+  uint64_t segment_size = (uint64_t) min(high - low + 1, max_segment_size);
+  int64_t thread_threshold = (int64_t) 1e7;
+  threads = ideal_num_threads(sqrt_high, threads, thread_threshold);
+  pod_vector<uint8_t> sieve(segment_size * threads);
+  uint64_t count = 0;
+
+  for (uint128_t seg_low = low; seg_low <= high; seg_low += segment_size)
+  {
+    uint128_t seg_high = min(seg_low + segment_size - 1, high);
+    uint64_t size = (uint64_t) (seg_high - seg_low) + 1;
+    uint64_t sqrt_seg = (uint64_t) isqrt(seg_high);
+    std::fill_n(sieve.data(), sieve.size(), (uint8_t) 0);
+
+    #pragma omp parallel for num_threads(threads)
+    for (int t = 0; t < threads; t++)
+    {
+      uint8_t* composite = &sieve[segment_size * t];
+      uint64_t start = (uint64_t) ((uint128_t) sqrt_seg * t / threads) + 1;
+      uint64_t stop = (uint64_t) ((uint128_t) sqrt_seg * (t + 1) / threads);
+      primesieve::iterator it(start, stop);
+      uint64_t prime = it.next_prime();
+
+      for (; prime <= stop; prime = it.next_prime())
+      {
+        // Cross off the multiples >= prime^2
+        uint64_t r = (uint64_t) (seg_low % prime);
+        uint128_t multiple = (r == 0) ? seg_low : seg_low + (prime - r);
+        multiple = max(multiple, (uint128_t) prime * prime);
+
+        if (multiple <= seg_high)
+          for (uint64_t i = (uint64_t) (multiple - seg_low); i < size; i += prime)
+            composite[i] = 1;
+      }
+    }
+
+    for (uint64_t i = 0; i < size; i++)
+    {
+      bool is_prime = (seg_low + i >= 2);
+      for (int t = 0; t < threads; t++)
+        is_prime &= !sieve[segment_size * t + i];
+      count += is_prime;
+    }
+
+    if (seg_high == high)
+      break;
+  }
+
+  return count;
+}
+
+#endif
+
+template <typename T>
+T count_primes_impl(T a,
+                    T b,
+                    int threads,
+                    bool is_print)
+{
+  a = max(a, 0);
+  if (a > b)
+    return 0;
+
+  bool is_sieve = is_sieve_gap(a - 1, b);
+
+  if (is_print)
+  {
+    print("");
+    print("=== count_primes(a, b) ===");
+    print("a", a);
+    print("b", b);
+    print(is_sieve ? "method = sieve" : "method = pi(b) - pi(a - 1)");
+    print("threads", threads);
+  }
+
+  double time = get_time();
+  T res;
+
+  if (is_sieve)
+    res = count_primes_sieve(a, b, threads);
+  else
+  {
+    // We compute the larger pi(b) first, with --cache-dir
+    // its PiTable is stored on disk and memory mapped
+    // by pi(a - 1) instead of sieving it again.
+    res = pi(b, threads);
+    if (a > 2)
+      res -= pi(a - 1, threads);
+  }
+
+  if (is_print)
+    print("count_primes", res, time);
+
+  return res;
+}
+
+} // namespace
+
+namespace primecount {
+
+/// Returns true if counting the primes inside ]x1, x2]
+/// is faster than computing pi(x2) from scratch. Sieving
+/// additionally requires generating the sieving primes
+/// <= sqrt(x2).
+///
+bool is_sieve_gap(int64_t x1, int64_t x2)
+{
+  int64_t x = max(x1, x2);
+  if (x < 2)
+    return true;
+
+  double gap = std::abs((double) x2 - (double) x1);
+  double cost = gap + (double) isqrt(x);
+  return cost < get_break_even((double) x);
+}
+
+/// Count the primes inside [low, high] using
+/// the segmented sieve of Eratosthenes.
+///
+int64_t count_primes_sieve(int64_t low, int64_t high, int threads)
+{
+  low = max(low, 0);
+  if (low > high)
+    return 0;
+
+  return (int64_t) count_primesieve(low, high, threads);
+}
+
+int64_t pi_from(int64_t x1, int64_t pi_x1, int64_t x2)
+{
+  return pi_from(x1, pi_x1, x2, get_num_threads());
+}
+
+/// Compute pi(x2) using the known pi(x1). If the gap
+/// between x1 and x2 is small we count the primes inside
+/// the gap, else we compute pi(x2) from scratch.
+///
+int64_t pi_from(int64_t x1,
+                int64_t pi_x1,
+                int64_t x2,
+                int threads,
+                bool is_print)
+{
+  if (x1 < 0 || pi_x1 < 0)
+    throw primecount_error("pi_from(x1, pi_x1, x2): x1 and pi_x1 must be >= 0");
+
+  bool is_sieve = is_sieve_gap(x1, x2);
+
+  if (is_print)
+  {
+    print("");
+    print("=== pi_from(x1, pi_x1, x2) ===");
+    print("x1", x1);
+    print("pi_x1", pi_x1);
+    print("x2", x2);
+    print(is_sieve ? "method = sieve gap" : "method = pi(x2)");
+    print("threads", threads);
+  }
+
+  if (x2 < 2)
+    return 0;
+  if (x2 == x1)
+    return pi_x1;
+  if (!is_sieve)
+    return is_print ? pi(x2, threads) : pi_noprint(x2, threads);
+
+  double time = get_time();
+  int64_t res;
+
+  if (x2 >= x1)
+    res = pi_x1 + count_primes_sieve(x1 + 1, x2, threads);
+  else
+    res = pi_x1 - count_primes_sieve(x2 + 1, x1, threads);
+
+  if (is_print)
+    print("pi_from", res, time);
+
+  return res;
+}
+
+/// Count the primes inside [a, b]. If the interval is
+/// small we count its primes using the segmented sieve of
+/// Eratosthenes, else we compute pi(b) - pi(a - 1).
+///
+int64_t count_primes(int64_t a,
+                     int64_t b,
+                     int threads,
+                     bool is_print)
+{
+  return count_primes_impl(a, b, threads, is_print);
+}
+
+#ifdef HAVE_INT128_T
+
+/// Count the primes inside [low, high], for numbers
+/// > primesieve::get_max_stop() we use our own
+/// segmented sieve of Eratosthenes.
+///
+int128_t count_primes_sieve(int128_t low, int128_t high, int threads)
+{
+  low = max(low, 0);
+  if (low > high)
+    return 0;
+
+  if (high <= (int128_t) primesieve::get_max_stop())
+    return count_primesieve((uint64_t) low, (uint64_t) high, threads);
+  else
+    return count_primes_segmented((uint128_t) low, (uint128_t) high, threads);
+}
+
+/// Returns true if counting the primes inside ]x1, x2]
+/// is faster than computing pi(x2) from scratch.
+///
+bool is_sieve_gap(int128_t x1, int128_t x2)
+{
+  int128_t x = max(x1, x2);
+  if (x <= std::numeric_limits<int64_t>::max())
+    return is_sieve_gap((int64_t) x1, (int64_t) x2);
+
+  double gap = std::abs((double) x2 - (double) x1);
+  double sqrtx = (double) isqrt(x);
+  double cost = gap + sqrtx;
+
+  // Above primesieve's limit each segment
+  // iterates over all sieving primes.
+  if (x > (int128_t) primesieve::get_max_stop())
+  {
+    double segments = std::ceil((gap + 1) / max_segment_size);
+    double sieving_primes = sqrtx / std::log(sqrtx);
+    cost = gap * number_cost + segments * sieving_primes * sieving_prime_cost;
+  }
+
+  return cost < get_break_even((double) x);
+}
+
+int128_t count_primes(int128_t a,
+                      int128_t b,
+                      int threads,
+                      bool is_print)
+{
+  a = max(a, 0);
+  if (a > b)
+    return 0;
+
+  // use 64-bit if possible
+  if (b <= std::numeric_limits<int64_t>::max())
+    return count_primes((int64_t) a, (int64_t) b, threads, is_print);
+
+  return count_primes_impl(a, b, threads, is_print);
+}
+
+#endif
+
+} // namespace
@@ -0,0 +1,278 @@
+///
+/// @file  profiling.cpp
+/// @brief Optional hot-path instrumentation, enabled using
+///        cmake -DWITH_PROFILING=ON (see profiling.hpp).
+///
+///        The counters of all threads are registered in a global
+///        list. When a formula starts and finishes we add up the
+///        counters of all threads, the difference is attributed
+///        to the formula. The CPU's performance counters are
+///        opened per thread using perf_event_open(), if this is
+///        not permitted (e.g. /proc/sys/kernel/perf_event_paranoid
+///        or inside a container) the corresponding columns are
+///        printed as n/a.
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <profiling.hpp>
+
+#if defined(ENABLE_PROFILING)
+
+#include <primecount-internal.hpp>
+
+#include <stdint.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+  #include <linux/perf_event.h>
+  #include <sys/ioctl.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#endif
+
+using namespace primecount;
+
+namespace {
+
+struct Row
+{
+  std::string formula;
+  uint64_t calls = 0;
+  double secs = 0;
+  uint64_t counters[PROFILE_COUNTERS] = { };
+  uint64_t perf[PERF_EVENTS] = { };
+};
+
+std::mutex mutex_;
+std::vector<ProfileThread*> threads_;
+// Counters of threads that have already exited
+uint64_t retired_counters_[PROFILE_COUNTERS] = { };
+uint64_t retired_perf_[PERF_EVENTS] = { };
+bool is_perf_ = true;
+bool is_owned_ = false;
+bool is_atexit_ = false;
+std::vector<Row> rows_;
+
+int perf_open(int event)
+{
+#if defined(__linux__)
+  uint64_t configs[PERF_EVENTS] =
+  {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES
+  };
+
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof(attr);
+  attr.config = configs[event];
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+
+  // Measure the calling thread on any CPU
+  long fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+  return (int) fd;
+#else
+  (void) event;
+  return -1;
+#endif
+}
+
+uint64_t perf_read(int fd)
+{
+  uint64_t value = 0;
+
+#if defined(__linux__)
+  if (fd >= 0 &&
+      read(fd, &value, sizeof(value)) != sizeof(value))
+    value = 0;
+#else
+  (void) fd;
+#endif
+
+  return value;
+}
+
+/// Add up the counters of all threads.
+/// Must be called with mutex_ locked.
+///
+void snapshot(uint64_t* counters, uint64_t* perf)
+{
+  std::copy_n(retired_counters_, PROFILE_COUNTERS, counters);
+  std::copy_n(retired_perf_, PERF_EVENTS, perf);
+
+  for (ProfileThread* thread : threads_)
+  {
+    for (int i = 0; i < PROFILE_COUNTERS; i++)
+      counters[i] += thread->counters[i];
+    for (int i = 0; i < PERF_EVENTS; i++)
+      perf[i] += perf_read(thread->perf_fds[i]);
+  }
+}
+
+std::string perf_str(uint64_t value)
+{
+  return is_perf_ ? std::to_string(value) : "n/a";
+}
+
+std::string ratio_str(uint64_t a, uint64_t b)
+{
+  if (!is_perf_ || b == 0)
+    return "n/a";
+
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(2) << (double) a / b;
+  return oss.str();
+}
+
+/// Print the summary table to stderr
+void print_profile()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (rows_.empty())
+    return;
+
+  std::ostream& out = std::cerr;
+  out << std::endl;
+  out << "=== Profile (WITH_PROFILING=ON) ===" << std::endl;
+  out << std::left << std::setw(12) << "Formula" << std::right
+      << std::setw(7) << "Calls"
+      << std::setw(11) << "Seconds"
+      << std::setw(16) << "Leaves"
+      << std::setw(16) << "Sieve::count"
+      << std::setw(16) << "Cross-offs"
+      << std::setw(16) << "Divisions"
+      << std::setw(18) << "Cycles"
+      << std::setw(18) << "Instructions"
+      << std::setw(7) << "IPC"
+      << std::setw(16) << "Cache misses"
+      << std::setw(13) << "Misses/leaf" << std::endl;
+
+  for (const Row& row : rows_)
+  {
+    out << std::left << std::setw(12) << row.formula << std::right
+        << std::setw(7) << row.calls
+        << std::setw(11) << std::fixed << std::setprecision(3) << row.secs
+        << std::setw(16) << row.counters[PROFILE_LEAVES]
+        << std::setw(16) << row.counters[PROFILE_SIEVE_COUNT]
+        << std::setw(16) << row.counters[PROFILE_CROSS_OFF]
+        << std::setw(16) << row.counters[PROFILE_DIVISIONS]
+        << std::setw(18) << perf_str(row.perf[PERF_CYCLES])
+        << std::setw(18) << perf_str(row.perf[PERF_INSTRUCTIONS])
+        << std::setw(7) << ratio_str(row.perf[PERF_INSTRUCTIONS], row.perf[PERF_CYCLES])
+        << std::setw(16) << perf_str(row.perf[PERF_CACHE_MISSES])
+        << std::setw(13) << ratio_str(row.perf[PERF_CACHE_MISSES], row.counters[PROFILE_LEAVES])
+        << std::endl;
+  }
+}
+
+} // namespace
+
+namespace primecount {
+
+ProfileThread::ProfileThread()
+{
+  for (int i = 0; i < PERF_EVENTS; i++)
+    perf_fds[i] = perf_open(i);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (int i = 0; i < PERF_EVENTS; i++)
+    if (perf_fds[i] < 0)
+      is_perf_ = false;
+
+  threads_.push_back(this);
+}
+
+ProfileThread::~ProfileThread()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  for (int i = 0; i < PROFILE_COUNTERS; i++)
+    retired_counters_[i] += counters[i];
+
+  for (int i = 0; i < PERF_EVENTS; i++)
+  {
+    retired_perf_[i] += perf_read(perf_fds[i]);
+#if defined(__linux__)
+    if (perf_fds[i] >= 0)
+      close(perf_fds[i]);
+#endif
+  }
+
+  threads_.erase(std::remove(threads_.begin(), threads_.end(), this), threads_.end());
+}
+
+ProfileScope::ProfileScope(const char* formula) :
+  formula_(formula)
+{
+  // Register the calling thread
+  profile_thread();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // Nested formula, e.g. D(x) inside of B(x)
+  if (is_owned_)
+    return;
+
+  if (!is_atexit_)
+  {
+    is_atexit_ = true;
+    std::atexit(print_profile);
+  }
+
+  is_owned_ = true;
+  is_owner_ = true;
+  time_ = get_time();
+  snapshot(counters_, perf_);
+}
+
+ProfileScope::~ProfileScope()
+{
+  if (!is_owner_)
+    return;
+
+  uint64_t counters[PROFILE_COUNTERS];
+  uint64_t perf[PERF_EVENTS];
+  double secs = get_time() - time_;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  snapshot(counters, perf);
+  is_owned_ = false;
+
+  auto row = std::find_if(rows_.begin(), rows_.end(),
+    [&](const Row& r) { return r.formula == formula_; });
+
+  if (row == rows_.end())
+  {
+    rows_.push_back(Row());
+    row = rows_.end() - 1;
+    row->formula = formula_;
+  }
+
+  row->calls++;
+  row->secs += secs;
+
+  for (int i = 0; i < PROFILE_COUNTERS; i++)
+    row->counters[i] += counters[i] - counters_[i];
+  for (int i = 0; i < PERF_EVENTS; i++)
+    row->perf[i] += perf[i] - perf_[i];
+}
+
+} // namespace
+
+#endif
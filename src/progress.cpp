@@ -0,0 +1,190 @@
+///
+/// @file  progress.cpp
+/// @brief Machine-readable progress output. If enabled using
+///        --progress-fd=FD the formulas write their progress as
+///        JSON lines to the file descriptor FD. Each line is
+///        written using a single write() call so that lines
+///        from different threads are never interleaved.
+///
+///        Event types:
+///        progress: formula, percent, elapsed and remaining
+///                  seconds, segments, segment_size, sum.
+///        thread:   statistics of a finished thread work item
+///                  (low, segments, segment_size, init_secs,
+///                  secs), used to graph scaling efficiency.
+///        finished: formula, elapsed seconds.
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <progress.hpp>
+#include <primecount-internal.hpp>
+#include <int128_t.hpp>
+#include <to_string.hpp>
+
+#include <stdint.h>
+#include <cmath>
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+#if defined(_WIN32)
+  #include <io.h>
+#else
+  #include <unistd.h>
+#endif
+
+namespace {
+
+int progress_fd_ = -1;
+
+// Only the outermost computation reports its
+// progress, nested computations which use the
+// same x share the progress of their parent.
+std::mutex mutex_;
+bool is_owned_ = false;
+primecount::maxint_t owner_x_ = 0;
+
+// Write at most 10 progress lines per second
+const double progress_interval = 0.1;
+
+void write_fd(int fd, const char* buf, std::size_t size)
+{
+  while (size > 0)
+  {
+#if defined(_WIN32)
+    int bytes = _write(fd, buf, (unsigned) size);
+#else
+    ssize_t bytes = ::write(fd, buf, size);
+#endif
+
+    // Progress output must never abort
+    // the computation, ignore errors.
+    if (bytes <= 0)
+      return;
+
+    buf += bytes;
+    size -= (std::size_t) bytes;
+  }
+}
+
+} // namespace
+
+namespace primecount {
+
+void set_progress_fd(int fd)
+{
+  progress_fd_ = fd;
+}
+
+bool is_progress()
+{
+  return progress_fd_ >= 0;
+}
+
+ProgressLine::ProgressLine(const std::string& event,
+                           const std::string& formula)
+{
+  json_ = "{\"event\":\"" + event + "\",\"formula\":\"" + formula + "\"";
+}
+
+ProgressLine& ProgressLine::add_int(const std::string& key, maxint_t value)
+{
+  json_ += ",\"" + key + "\":" + to_string(value);
+  return *this;
+}
+
+ProgressLine& ProgressLine::add_double(const std::string& key, double value)
+{
+  // NaN and infinity are not valid JSON
+  if (!std::isfinite(value))
+    value = -1;
+
+  char buf[64];
+  std::snprintf(buf, sizeof(buf), "%.3f", value);
+  json_ += ",\"" + key + "\":" + buf;
+  return *this;
+}
+
+void ProgressLine::write() const
+{
+  if (is_progress())
+  {
+    std::string line = json_ + "}\n";
+    write_fd(progress_fd_, line.data(), line.size());
+  }
+}
+
+Progress::Progress(const std::string& formula, maxint_t x) :
+  formula_(formula),
+  start_time_(get_time())
+{
+  if (!is_progress())
+    return;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // Nested computation, e.g. D(x) inside of pi_gourdon(x)
+  if (is_owned_)
+  {
+    is_enabled_ = (x == owner_x_);
+    return;
+  }
+
+  is_owned_ = true;
+  is_owner_ = true;
+  is_enabled_ = true;
+  owner_x_ = x;
+}
+
+Progress::~Progress()
+{
+  if (is_enabled_)
+    line("finished").add_double("elapsed_secs", get_time() - start_time_).write();
+
+  if (is_owner_)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_owned_ = false;
+  }
+}
+
+/// Returns true if progress output is enabled for this
+/// formula and if enough time has elapsed since the last
+/// progress line. The calling code has to ensure that
+/// only 1 thread at a time executes this method.
+///
+bool Progress::is_due()
+{
+  if (!is_enabled_)
+    return false;
+
+  double time = get_time();
+  if (time - time_ < progress_interval)
+    return false;
+
+  time_ = time;
+  return true;
+}
+
+/// Linear estimate of the remaining seconds,
+/// returns -1 if unknown.
+///
+double Progress::remaining_secs(double percent) const
+{
+  if (percent <= 0)
+    return -1;
+
+  double secs = get_time() - start_time_;
+  return secs * (100 / percent) - secs;
+}
+
+ProgressLine Progress::line(const std::string& event) const
+{
+  return ProgressLine(event, formula_);
+}
+
+} // namespace
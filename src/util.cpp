@@ -402,6 +402,46 @@ std::pair<double, double> get_alpha_gourdon(maxint_t x)
   return std::make_pair(alpha_y, alpha_z);
 }
 
+/// y = x^(1/3) * alpha, this is the y used by
+/// pi_deleglise_rivat(x) before the memory limit
+/// is applied.
+///
+int64_t get_y_deleglise_rivat(maxint_t x)
+{
+  double alpha = get_alpha_deleglise_rivat(x);
+  int64_t x13 = (int64_t) iroot<3>(x);
+  return (int64_t) (x13 * alpha);
+}
+
+/// Returns y and z used by pi_gourdon(x) before
+/// the memory limit is applied.
+/// y = x^(1/3) * alpha_y, with x^(1/3) < y < x^(1/2)
+/// z = y * alpha_z, with y <= z < x^(1/2)
+///
+std::pair<int64_t, int64_t> get_yz_gourdon(maxint_t x)
+{
+  auto alpha = get_alpha_gourdon(x);
+  double alpha_y = alpha.first;
+  double alpha_z = alpha.second;
+  int64_t x13 = (int64_t) iroot<3>(x);
+  int64_t sqrtx = (int64_t) isqrt(x);
+  int64_t y = (int64_t) (x13 * alpha_y);
+
+  // x^(1/3) < y < x^(1/2)
+  y = max(y, x13 + 1);
+  y = min(y, sqrtx - 1);
+  y = max(y, (int64_t) 1);
+
+  int64_t z = (int64_t) (y * alpha_z);
+
+  // y <= z < x^(1/2)
+  z = max(z, y);
+  z = min(z, sqrtx - 1);
+  z = max(z, (int64_t) 1);
+
+  return std::make_pair(y, z);
+}
+
 /// x_star = max(x^(1/4), x / y^2)
 ///
 /// After my implementation of Xavier Gourdon's algorithm worked for
@@ -40,12 +40,24 @@ int main()
   std::cout << "primecount_nth_prime(" << n << ") = " << res;
   check(res == 9999999967);
 
+  int64_t ns[3] = { 455052511, 25, 1000 };
+  int64_t primes[3] = { 0, 0, 0 };
+  primecount_nth_prime_batch(ns, primes, 3);
+  std::cout << "primecount_nth_prime_batch(455052511, 25, 1000) = " << primes[0] << ", " << primes[1] << ", " << primes[2];
+  check(primes[0] == 9999999967 && primes[1] == 97 && primes[2] == 7919);
+
   n = (int64_t) 1e12;
   int64_t a = 78498;
   res = primecount_phi(n, a);
   std::cout << "primecount_phi(" << n << ", " << a << ") = " << res;
   check(res == 37607833521);
 
+  int64_t x[3] = { 1000, (int64_t) 1e10, 100 };
+  int64_t pix[3] = { 0, 0, 0 };
+  primecount_pi_batch(x, pix, 3);
+  std::cout << "primecount_pi_batch(1000, 1e10, 100) = " << pix[0] << ", " << pix[1] << ", " << pix[2];
+  check(pix[0] == 168 && pix[1] == 455052511 && pix[2] == 25);
+
   const char* in = "1000000000000";
   char out[32];
   primecount_pi_str(in, out, 32);
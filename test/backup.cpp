@@ -0,0 +1,149 @@
+///
+/// @file   backup.cpp
+/// @brief  Test resuming interrupted pi_gourdon(x) and
+///         pi_deleglise_rivat(x) computations from a backup file.
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <primecount.hpp>
+#include <primecount-internal.hpp>
+#include <backup.hpp>
+#include <gourdon.hpp>
+#include <imath.hpp>
+#include <PhiTiny.hpp>
+#include <Sieve.hpp>
+
+#include <stdint.h>
+#include <cstdio>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+
+using namespace primecount;
+
+void check(bool OK)
+{
+  std::cout << "   " << (OK ? "OK" : "ERROR") << "\n";
+  if (!OK)
+    std::exit(1);
+}
+
+void write(const std::string& filename,
+           const std::map<std::string, std::string>& values)
+{
+  std::ofstream file(filename);
+  for (const auto& kv : values)
+    file << kv.first << " = " << kv.second << '\n';
+}
+
+int main()
+{
+  std::string filename = "primecount_test.backup";
+  int threads = get_num_threads();
+  int64_t x = (int64_t) 1e12;
+  int64_t res = pi_gourdon_64(x, threads, false);
+
+  set_backup_file(filename);
+  set_backup_interval(0);
+
+  // Create new backup
+  int64_t res1 = pi_gourdon_64(x, threads, false);
+  std::cout << "pi_gourdon_64(" << x << ") = " << res1;
+  check(res1 == res);
+
+  auto values = Backup::read(filename);
+  std::cout << "Backup formula = " << values["formula"];
+  check(values["formula"] == "pi_gourdon");
+  std::cout << "Backup x = " << values["x"];
+  check(values["x"] == std::to_string(x));
+  std::cout << "Backup D = " << values["D"];
+  check(values.count("D") && !values.count("D.low"));
+
+  // Resume from completed backup
+  set_resume(true);
+  int64_t res2 = pi_gourdon_64(x, threads, false);
+  std::cout << "Resumed pi_gourdon_64(" << x << ") = " << res2;
+  check(res2 == res);
+
+  // Simulate an interrupted computation of D(x, y)
+  // where the first interval has not been finished.
+  int64_t z = (int64_t) to_maxint(values["z"]);
+  int64_t xz = x / z;
+  int64_t segment_size = Sieve::get_segment_size(1 << 12);
+  values.erase("D");
+  values["D.sieve_limit"] = std::to_string(xz);
+  values["D.low"] = std::to_string(segment_size);
+  values["D.max_low"] = "0";
+  values["D.segments"] = "1";
+  values["D.segment_size"] = std::to_string(segment_size);
+  values["D.sum"] = "0";
+  values["D.pending"] = "0:1:" + std::to_string(segment_size);
+  write(filename, values);
+
+  int64_t res3 = pi_gourdon_64(x, threads, false);
+  std::cout << "Resumed interrupted pi_gourdon_64(" << x << ") = " << res3;
+  check(res3 == res);
+
+  values = Backup::read(filename);
+  std::cout << "D(x, y) progress removed from backup";
+  check(!values.count("D.low") && values.count("D"));
+
+  // Deleglise-Rivat algorithm
+  set_resume(false);
+  int64_t res5 = pi_deleglise_rivat_64(x, threads, false);
+  std::cout << "pi_deleglise_rivat_64(" << x << ") = " << res5;
+  check(res5 == res);
+
+  values = Backup::read(filename);
+  std::cout << "Backup formula = " << values["formula"];
+  check(values["formula"] == "pi_deleglise_rivat");
+  std::cout << "Backup S2_easy = " << values["S2_easy"];
+  check(values.count("S2_easy") && !values.count("S2_easy.b"));
+  std::cout << "Backup S2_hard = " << values["S2_hard"];
+  check(values.count("S2_hard") && !values.count("S2_hard.low"));
+
+  // Simulate an interrupted computation of S2_easy(x, y)
+  // and S2_hard(x, y).
+  int64_t y = (int64_t) to_maxint(values["y"]);
+  int64_t c = PhiTiny::get_c(y);
+  int64_t pi_sqrty = pi_noprint(isqrt(y), threads);
+  values.erase("S2_easy");
+  values.erase("S2_hard");
+  values["S2_easy.y"] = std::to_string(y);
+  values["S2_easy.b"] = std::to_string(std::max(c, pi_sqrty) + 1);
+  values["S2_easy.sum"] = "0";
+  values["S2_hard.sieve_limit"] = std::to_string(x / y);
+  values["S2_hard.low"] = std::to_string(segment_size);
+  values["S2_hard.max_low"] = "0";
+  values["S2_hard.segments"] = "1";
+  values["S2_hard.segment_size"] = std::to_string(segment_size);
+  values["S2_hard.sum"] = "0";
+  values["S2_hard.pending"] = "0:1:" + std::to_string(segment_size);
+  write(filename, values);
+
+  set_resume(true);
+  int64_t res6 = pi_deleglise_rivat_64(x, threads, false);
+  std::cout << "Resumed interrupted pi_deleglise_rivat_64(" << x << ") = " << res6;
+  check(res6 == res);
+
+  // A backup of a different x must not be used
+  int64_t x2 = x + 1000;
+  int64_t res4 = pi_gourdon_64(x2, threads, false);
+  std::cout << "pi_gourdon_64(" << x2 << ") = " << res4;
+  set_backup_file("");
+  check(res4 == pi_gourdon_64(x2, threads, false));
+
+  std::remove(filename.c_str());
+
+  std::cout << std::endl;
+  std::cout << "All tests passed successfully!" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,135 @@
+///
+/// @file   concurrent.cpp
+/// @brief  Test computing D and AC, B (Gourdon) and S2_hard and
+///         S2_trivial, S2_easy (Deleglise-Rivat) concurrently.
+///         The formulas are only computed concurrently when
+///         using >= 4 threads, which we force even if the
+///         CPU has fewer cores. We also check that the
+///         concurrent formulas correctly share the backup file
+///         and that a partially written backup file is
+///         correctly resumed.
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <primecount.hpp>
+#include <primecount-internal.hpp>
+#include <backup.hpp>
+#include <concurrent.hpp>
+#include <gourdon.hpp>
+
+#include <stdint.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+
+using namespace primecount;
+
+void check(bool OK)
+{
+  std::cout << "   " << (OK ? "OK" : "ERROR") << "\n";
+  if (!OK)
+    std::exit(1);
+}
+
+/// Write a backup file that only contains the
+/// given values, i.e. an interrupted computation.
+///
+void write_backup(const std::string& filename,
+                  const std::map<std::string, std::string>& values)
+{
+  std::ofstream file(filename, std::ios::trunc);
+  file << "# primecount backup file, do not edit!\n";
+  for (const auto& kv : values)
+    file << kv.first << " = " << kv.second << '\n';
+}
+
+int main()
+{
+  int threads = 8;
+  int64_t x = (int64_t) 1e15;
+  int64_t pix = 29844570422669ll;
+
+  std::cout << "concurrent_threads(8, 0.55) = " << concurrent_threads(8, 0.55);
+  check(concurrent_threads(8, 0.55) == 5);
+  std::cout << "concurrent_threads(4, 0.99) = " << concurrent_threads(4, 0.99);
+  check(concurrent_threads(4, 0.99) == 3);
+  std::cout << "concurrent_threads(4, 0.01) = " << concurrent_threads(4, 0.01);
+  check(concurrent_threads(4, 0.01) == 1);
+
+  int64_t res = pi_gourdon_64(x, threads, false);
+  std::cout << "pi_gourdon_64(" << x << ") = " << res;
+  check(res == pix);
+
+  res = pi_deleglise_rivat_64(x, threads, false);
+  std::cout << "pi_deleglise_rivat_64(" << x << ") = " << res;
+  check(res == pix);
+
+#if defined(HAVE_INT128_T)
+  res = (int64_t) pi_gourdon_128(x, threads, false);
+  std::cout << "pi_gourdon_128(" << x << ") = " << res;
+  check(res == pix);
+
+  res = (int64_t) pi_deleglise_rivat_128(x, threads, false);
+  std::cout << "pi_deleglise_rivat_128(" << x << ") = " << res;
+  check(res == pix);
+#endif
+
+  // AC, B and D concurrently update the backup file
+  std::string filename = "concurrent_test.backup";
+  std::remove(filename.c_str());
+  set_backup_file(filename);
+  res = pi_gourdon_64(x, threads, false);
+  set_backup_file("");
+
+  std::cout << "pi_gourdon_64(" << x << ") with backup = " << res;
+  check(res == pix);
+
+  auto values = Backup::read(filename);
+
+  std::cout << "backup file contains AC, B and D";
+  check(!values["AC"].empty() &&
+        !values["B"].empty() &&
+        !values["D"].empty());
+
+  // Resume from a backup file that only contains AC, the
+  // remaining B and D formulas are computed concurrently
+  // and D starts with d_approx = 0.
+  // Then resume from a backup file that only contains D.
+  for (std::string key : { "AC", "D" })
+  {
+    auto partial = values;
+    for (std::string formula : { "AC", "B", "D" })
+      if (formula != key)
+        partial.erase(formula);
+
+    write_backup(filename, partial);
+    set_backup_file(filename);
+    set_resume(true);
+    res = pi_gourdon_64(x, threads, false);
+    set_resume(false);
+    set_backup_file("");
+
+    std::cout << "pi_gourdon_64(" << x << ") resumed with " << key << " = " << res;
+    check(res == pix);
+
+    auto resumed = Backup::read(filename);
+    std::cout << "resumed backup file contains AC, B and D";
+    check(resumed["AC"] == values["AC"] &&
+          resumed["B"] == values["B"] &&
+          resumed["D"] == values["D"]);
+  }
+
+  std::remove(filename.c_str());
+
+  std::cout << std::endl;
+  std::cout << "All tests passed successfully!" << std::endl;
+
+  return 0;
+}
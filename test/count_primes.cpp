@@ -0,0 +1,95 @@
+///
+/// @file   count_primes.cpp
+/// @brief  Test count_primes(a, b) which counts the primes
+///         inside [a, b] using either the sieve of
+///         Eratosthenes or pi(b) - pi(a - 1).
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <primecount.hpp>
+#include <primecount-internal.hpp>
+#include <primesieve.hpp>
+
+#include <stdint.h>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+
+using namespace primecount;
+
+void check(bool OK)
+{
+  std::cout << "   " << (OK ? "OK" : "ERROR") << "\n";
+  if (!OK)
+    std::exit(1);
+}
+
+int main()
+{
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  std::uniform_int_distribution<int64_t> dist(1, (int64_t) 1e11);
+  std::uniform_int_distribution<int64_t> gap(0, (int64_t) 1e8);
+
+  std::cout << "count_primes(0, 100) = " << count_primes(0, 100);
+  check(count_primes(0, 100) == 25);
+  std::cout << "count_primes(2, 2) = " << count_primes(2, 2);
+  check(count_primes(2, 2) == 1);
+  std::cout << "count_primes(100, 10) = " << count_primes(100, 10);
+  check(count_primes(100, 10) == 0);
+  std::cout << "count_primes(-10, 10) = " << count_primes(-10, 10);
+  check(count_primes(-10, 10) == 4);
+
+  // Small intervals are sieved
+  for (int i = 0; i < 50; i++)
+  {
+    int64_t a = dist(gen);
+    int64_t b = a + gap(gen) / (1 + i % 10 * 100);
+    int64_t res = count_primes(a, b);
+    std::cout << "count_primes(" << a << ", " << b << ") = " << res;
+    check(res == (int64_t) primesieve::count_primes(a, b));
+  }
+
+  // Large intervals use pi(b) - pi(a - 1)
+  for (int i = 0; i < 20; i++)
+  {
+    int64_t a = dist(gen);
+    int64_t b = dist(gen);
+    int64_t res = count_primes(a, b);
+    std::cout << "count_primes(" << a << ", " << b << ") = " << res;
+    check(res == (a > b ? 0 : pi(b) - pi(a - 1)));
+  }
+
+  {
+    std::string res = count_primes("1000000000000", "1000001000000");
+    std::cout << "count_primes(10^12, 10^12 + 10^6) = " << res;
+    check(res == "36249");
+  }
+
+#if defined(HAVE_INT128_T)
+  // Small intervals near 2^64 and above are sieved
+  {
+    std::string res = count_primes("18446744030759878000", "18446744030759879000");
+    std::cout << "count_primes(18446744030759878000, 18446744030759879000) = " << res;
+    check(res == "28");
+
+    res = count_primes("18446744073709551000", "18446744073709552000");
+    std::cout << "count_primes(18446744073709551000, 18446744073709552000) = " << res;
+    check(res == "21");
+
+    res = count_primes("100000000000000000000", "100000000000000100000");
+    std::cout << "count_primes(10^20, 10^20 + 10^5) = " << res;
+    check(res == "2115");
+  }
+#endif
+
+  std::cout << std::endl;
+  std::cout << "All tests passed successfully!" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,89 @@
+///
+/// @file   max_memory.cpp
+/// @brief  Test set_max_memory(bytes). pi_gourdon(x) and
+///         pi_deleglise_rivat(x) decrease y and z if the
+///         estimated memory usage exceeds the memory limit.
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <primecount.hpp>
+#include <primecount-internal.hpp>
+#include <gourdon.hpp>
+#include <imath.hpp>
+
+#include <stdint.h>
+#include <iostream>
+#include <cstdlib>
+
+using namespace primecount;
+
+void check(bool OK)
+{
+  std::cout << "   " << (OK ? "OK" : "ERROR") << "\n";
+  if (!OK)
+    std::exit(1);
+}
+
+int main()
+{
+  int threads = get_num_threads();
+  int64_t x = (int64_t) 1e14;
+  int64_t pix = 3204941750802ll;
+
+  std::cout << "get_max_memory() = " << get_max_memory();
+  check(get_max_memory() == 0);
+
+  auto alpha = get_alpha_gourdon(x);
+  int64_t y = (int64_t) (iroot<3>(x) * alpha.first);
+  int64_t z = (int64_t) (y * alpha.second);
+  int64_t bytes = memory_usage_gourdon(x, y, z, threads, false);
+  int64_t max_memory = bytes / 4;
+  set_max_memory(max_memory);
+
+  std::cout << "get_max_memory() = " << get_max_memory();
+  check((int64_t) get_max_memory() == max_memory);
+
+  int64_t y2 = y;
+  int64_t z2 = z;
+  fit_max_memory_gourdon(x, y2, z2, threads, false);
+  bytes = memory_usage_gourdon(x, y2, z2, threads, false);
+  std::cout << "memory_usage_gourdon(" << x << ", " << y2 << ", " << z2 << ") = " << bytes;
+  check(bytes <= max_memory && y2 <= y && z2 <= z && z2 >= y2);
+
+  y2 = y;
+  fit_max_memory_deleglise_rivat(x, y2, threads);
+  bytes = memory_usage_deleglise_rivat(x, y2, threads);
+  std::cout << "memory_usage_deleglise_rivat(" << x << ", " << y2 << ") = " << bytes;
+  check(bytes <= max_memory && y2 <= y);
+
+  std::cout << "pi_gourdon(" << x << ") = " << pi_gourdon_64(x, threads, false);
+  check(pi_gourdon_64(x, threads, false) == pix);
+
+  std::cout << "pi_deleglise_rivat(" << x << ") = " << pi_deleglise_rivat_64(x, threads, false);
+  check(pi_deleglise_rivat_64(x, threads, false) == pix);
+
+  // A memory limit that is too small must throw
+  set_max_memory(1 << 10);
+
+  try {
+    pi_gourdon_64(x, threads, false);
+    std::cout << "pi_gourdon(" << x << ") with 1 KiB of memory";
+    check(false);
+  }
+  catch (primecount_error& e) {
+    std::cout << "OK: " << e.what() << std::endl;
+  }
+
+  set_max_memory(0);
+  std::cout << "pi(" << x << ") = " << pi(x);
+  check(pi(x) == pix);
+
+  std::cout << std::endl;
+  std::cout << "All tests passed successfully!" << std::endl;
+
+  return 0;
+}
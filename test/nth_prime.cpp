@@ -0,0 +1,68 @@
+///
+/// @file   nth_prime.cpp
+/// @brief  Test the nth_prime(n) and nth_prime_batch(n)
+///         functions.
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <primecount.hpp>
+#include <primecount-internal.hpp>
+
+#include <stdint.h>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace primecount;
+
+void check(bool OK)
+{
+  std::cout << "   " << (OK ? "OK" : "ERROR") << "\n";
+  if (!OK)
+    std::exit(1);
+}
+
+int main()
+{
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  std::uniform_int_distribution<int64_t> dist(1, (int64_t) 1e10);
+
+  for (int i = 0; i < 30; i++)
+  {
+    int64_t n = (dist(gen) >> (i % 10 * 3)) + 1;
+    int64_t prime = nth_prime(n);
+    std::cout << "nth_prime(" << n << ") = " << prime;
+    check(pi(prime) == n && pi(prime - 1) == n - 1);
+  }
+
+  // The Ri_inverse(n) approximation is far from the
+  // nth prime, the gap is counted in parallel.
+  int64_t n = (int64_t) 1e13;
+  int64_t prime = nth_prime(n);
+  std::cout << "nth_prime(" << n << ") = " << prime;
+  check(prime == 323780508946331ll);
+
+  // Every 10^6th prime up to 10^8, the gaps are sieved
+  std::vector<int64_t> ns = { 1, 25, 1000, 1000 };
+  for (int64_t i = 1; i <= 100; i++)
+    ns.push_back(i * 1000000);
+  std::shuffle(ns.begin(), ns.end(), gen);
+  std::vector<int64_t> primes = nth_prime_batch(ns);
+  bool OK = primes.size() == ns.size();
+  for (std::size_t i = 0; OK && i < ns.size(); i++)
+    OK = pi(primes[i]) == ns[i] && pi(primes[i] - 1) == ns[i] - 1;
+  std::cout << "nth_prime_batch(" << ns.size() << " numbers)";
+  check(OK);
+
+  std::cout << std::endl;
+  std::cout << "All tests passed successfully!" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,56 @@
+///
+/// @file   phi_threads.cpp
+/// @brief  Test phi(x, a) using multiple threads. The small
+///         phi(x, a) cache levels are computed in parallel
+///         and shared by all threads.
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <primecount-internal.hpp>
+
+#include <stdint.h>
+#include <iostream>
+#include <cstdlib>
+#include <random>
+
+using namespace primecount;
+
+void check(bool OK)
+{
+  std::cout << "   " << (OK ? "OK" : "ERROR") << "\n";
+  if (!OK)
+    std::exit(1);
+}
+
+int main()
+{
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  std::uniform_int_distribution<int64_t> dist((int64_t) 5e14, (int64_t) 1e15);
+
+  // x must be large enough so that the shared
+  // cache levels are split into multiple chunks.
+  int64_t x = dist(gen);
+  int64_t as[] = { 40, 100, 150 };
+
+  for (int64_t a : as)
+  {
+    int64_t phi1 = phi(x, a, 1, false);
+
+    for (int threads = 2; threads <= 8; threads++)
+    {
+      int64_t phi2 = phi(x, a, threads, false);
+      std::cout << "phi(" << x << ", " << a << ", threads = " << threads << ") = " << phi2;
+      check(phi1 == phi2);
+    }
+  }
+
+  std::cout << std::endl;
+  std::cout << "All tests passed successfully!" << std::endl;
+
+  return 0;
+}
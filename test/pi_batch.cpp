@@ -0,0 +1,70 @@
+///
+/// @file   pi_batch.cpp
+/// @brief  Test pi_batch(x) which counts the primes <= x
+///         for many x values.
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <primecount.hpp>
+#include <primecount-internal.hpp>
+
+#include <stdint.h>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace primecount;
+
+void check(bool OK)
+{
+  std::cout << "   " << (OK ? "OK" : "ERROR") << "\n";
+  if (!OK)
+    std::exit(1);
+}
+
+void check_batch(const std::vector<int64_t>& x)
+{
+  std::vector<int64_t> res = pi_batch(x);
+  std::cout << "pi_batch(" << x.size() << " numbers)";
+
+  bool OK = res.size() == x.size();
+  for (std::size_t i = 0; OK && i < x.size(); i++)
+    OK = res[i] == (x[i] < 2 ? 0 : pi(x[i]));
+
+  check(OK);
+}
+
+int main()
+{
+  std::random_device rd;
+  std::mt19937 gen(rd());
+
+  check_batch({});
+  check_batch({ -10, 0, 1, 2, 3, 100, 100, 1000000007, 1000000007, 10 });
+
+  // Nearby x values, the gaps are sieved
+  std::vector<int64_t> x;
+  for (int64_t i = 1; i <= 50; i++)
+    x.push_back(i * (int64_t) 1e9);
+  std::shuffle(x.begin(), x.end(), gen);
+  check_batch(x);
+
+  for (int i = 0; i < 10; i++)
+  {
+    std::uniform_int_distribution<int64_t> dist(0, (int64_t) 1 << (20 + i * 2));
+    x.clear();
+    for (int j = 0; j < 20; j++)
+      x.push_back(dist(gen));
+    check_batch(x);
+  }
+
+  std::cout << std::endl;
+  std::cout << "All tests passed successfully!" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,60 @@
+///
+/// @file   pi_from.cpp
+/// @brief  Test pi_from(x1, pi_x1, x2) which computes pi(x2)
+///         using the known pi(x1).
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <primecount.hpp>
+#include <primecount-internal.hpp>
+
+#include <stdint.h>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+using namespace primecount;
+
+void check(bool OK)
+{
+  std::cout << "   " << (OK ? "OK" : "ERROR") << "\n";
+  if (!OK)
+    std::exit(1);
+}
+
+int main()
+{
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  std::uniform_int_distribution<int64_t> dist(0, (int64_t) 1e11);
+  std::uniform_int_distribution<int64_t> gap(-(int64_t) 1e8, (int64_t) 1e8);
+
+  std::cout << "is_sieve_gap(1e12, 1e12 + 1e6)";
+  check(is_sieve_gap((int64_t) 1e12, (int64_t) (1e12 + 1e6)));
+  std::cout << "!is_sieve_gap(1e12, 2e12)";
+  check(!is_sieve_gap((int64_t) 1e12, (int64_t) 2e12));
+  std::cout << "!is_sieve_gap(1e18, 1e18 + 1e12)";
+  check(!is_sieve_gap((int64_t) 1e18, (int64_t) (1e18 + 1e12)));
+
+  for (int i = 0; i < 100; i++)
+  {
+    int64_t x1 = dist(gen);
+    int64_t x2 = x1 + gap(gen) / (1 + i % 10 * 1000);
+    if (i % 10 == 0)
+      x2 = dist(gen);
+
+    int64_t pi_x1 = pi(x1);
+    int64_t res = pi_from(x1, pi_x1, x2);
+    std::cout << "pi_from(" << x1 << ", " << pi_x1 << ", " << x2 << ") = " << res;
+    check(res == (x2 < 2 ? 0 : pi(x2)));
+  }
+
+  std::cout << std::endl;
+  std::cout << "All tests passed successfully!" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,110 @@
+///
+/// @file   pi_table_cache.cpp
+/// @brief  Test the PiTable file cache (--cache-dir).
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <PiTable.hpp>
+#include <PiTableCache.hpp>
+#include <primecount.hpp>
+#include <primecount-internal.hpp>
+
+#include <stdint.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace primecount;
+
+void check(bool OK)
+{
+  std::cout << "   " << (OK ? "OK" : "ERROR") << "\n";
+  if (!OK)
+    std::exit(1);
+}
+
+bool equal(const PiTable& pi1, const PiTable& pi2, uint64_t max_x)
+{
+  for (uint64_t x = 0; x <= max_x; x++)
+    if (pi1[x] != pi2[x])
+      return false;
+
+  return true;
+}
+
+int main()
+{
+  int threads = get_num_threads();
+  uint64_t max_x = 1000000;
+  PiTable reference(max_x, threads);
+
+  set_cache_dir(".");
+  std::string filename = PiTableFile::filename();
+  std::remove(filename.c_str());
+
+  {
+    // Creates the cache file
+    PiTable pi(max_x * 2, threads);
+    std::cout << "PiTable(" << max_x * 2 << ") stored in " << filename;
+    check(std::ifstream(filename).good());
+  }
+
+  {
+    // Corrupt a byte of the PiTable data. The
+    // cache file has not been memory mapped yet.
+    std::fstream file(filename, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(1000);
+    char c = 0;
+    file.read(&c, 1);
+    c ^= 0x55;
+    file.seekp(1000);
+    file.write(&c, 1);
+  }
+
+  std::cout << "Corrupted cache file rejected";
+  check(!PiTableFile::load(max_x));
+
+  {
+    PiTable pi(max_x, threads);
+    std::cout << "PiTable(" << max_x << ") without valid cache file";
+    check(equal(pi, reference, max_x));
+  }
+
+  std::remove(filename.c_str());
+  set_cache_dir(".");
+
+  {
+    PiTable pi(max_x * 2, threads);
+    std::cout << "PiTable(" << max_x * 2 << ") stored in " << filename;
+    check(std::ifstream(filename).good());
+  }
+
+  // Drop the process-wide cached file and
+  // load the PiTable from disk.
+  set_cache_dir(".");
+  std::cout << "PiTableFile::load(" << max_x * 3 / 2 << ")";
+  check(PiTableFile::load(max_x * 3 / 2) != nullptr);
+
+  std::cout << "PiTableFile::load(" << max_x * 4 << ") not cached";
+  check(PiTableFile::load(max_x * 4) == nullptr);
+
+  {
+    PiTable pi(max_x, threads);
+    std::cout << "PiTable(" << max_x << ") from cache file";
+    check(equal(pi, reference, max_x));
+  }
+
+  std::remove(filename.c_str());
+  set_cache_dir("");
+
+  std::cout << std::endl;
+  std::cout << "All tests passed successfully!" << std::endl;
+
+  return 0;
+}
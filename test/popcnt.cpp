@@ -0,0 +1,73 @@
+///
+/// @file   popcnt.cpp
+/// @brief  Test popcnt64(x) function. The test programs are
+///         compiled without -mpopcnt, hence on x64 this tests
+///         the CPUID runtime dispatching of popcnt.hpp.
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <popcnt.hpp>
+
+#include <stdint.h>
+#include <iostream>
+#include <cstdlib>
+#include <random>
+
+void check(bool OK)
+{
+  std::cout << "   " << (OK ? "OK" : "ERROR") << "\n";
+  if (!OK)
+    std::exit(1);
+}
+
+uint64_t popcnt_naive(uint64_t x)
+{
+  uint64_t cnt = 0;
+  for (; x != 0; x >>= 1)
+    cnt += x & 1;
+  return cnt;
+}
+
+int main()
+{
+  std::random_device rd;
+  std::mt19937_64 gen(rd());
+
+  for (int i = 0; i < 64; i++)
+  {
+    uint64_t x = 1ull << i;
+    std::cout << "popcnt64(" << x << ") = " << popcnt64(x);
+    check(popcnt64(x) == 1);
+    std::cout << "popcnt64(" << x - 1 << ") = " << popcnt64(x - 1);
+    check(popcnt64(x - 1) == (uint64_t) i);
+  }
+
+  for (int i = 0; i < 10000; i++)
+  {
+    uint64_t x = gen();
+    std::cout << "popcnt64(" << x << ") = " << popcnt64(x);
+    check(popcnt64(x) == popcnt_naive(x));
+  }
+
+#if defined(ENABLE_CPUID_POPCNT)
+  for (int i = 0; i < 10000; i++)
+  {
+    uint64_t x = gen();
+    std::cout << "popcnt64_bitwise(" << x << ") = " << popcnt64_bitwise(x);
+    check(popcnt64_bitwise(x) == popcnt_naive(x));
+  }
+#endif
+
+  uint64_t x = ~0ull;
+  std::cout << "popcnt64(" << x << ") = " << popcnt64(x);
+  check(popcnt64(x) == 64);
+
+  std::cout << std::endl;
+  std::cout << "All tests passed successfully!" << std::endl;
+
+  return 0;
+}
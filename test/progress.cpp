@@ -0,0 +1,123 @@
+///
+/// @file   progress.cpp
+/// @brief  Test the --progress-fd JSON lines output. Only the
+///         outermost formulas must be reported, nested
+///         computations e.g. pi(x / p) inside of B(x) must
+///         not write any progress lines.
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <primecount.hpp>
+#include <primecount-internal.hpp>
+#include <gourdon.hpp>
+#include <progress.hpp>
+
+#include <stdint.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+
+using namespace primecount;
+
+void check(bool OK)
+{
+  std::cout << "   " << (OK ? "OK" : "ERROR") << "\n";
+  if (!OK)
+    std::exit(1);
+}
+
+std::string get_value(const std::string& line, const std::string& key)
+{
+  std::string str = "\"" + key + "\":";
+  std::size_t pos = line.find(str);
+  if (pos == std::string::npos)
+    return "";
+
+  pos += str.size();
+  std::size_t end = line.find_first_of(",}", pos);
+  std::string value = line.substr(pos, end - pos);
+
+  if (!value.empty() && value[0] == '"')
+    value = value.substr(1, value.size() - 2);
+
+  return value;
+}
+
+int main()
+{
+  std::string filename = "progress_test.jsonl";
+  FILE* file = std::fopen(filename.c_str(), "w");
+  if (!file)
+  {
+    std::cerr << "failed to create " << filename << std::endl;
+    return 1;
+  }
+
+  int threads = get_num_threads();
+  int64_t x = (int64_t) 1e15;
+  set_progress_fd(fileno(file));
+  int64_t res = pi_gourdon_64(x, threads, false);
+  set_progress_fd(-1);
+  std::fclose(file);
+
+  std::cout << "pi_gourdon(" << x << ") = " << res;
+  check(res == 29844570422669ll);
+
+  std::ifstream lines(filename);
+  std::string line;
+  std::map<std::string, int> finished;
+  int progress = 0;
+  int threadLines = 0;
+
+  while (std::getline(lines, line))
+  {
+    std::cout << line;
+    check(line.front() == '{' && line.back() == '}');
+
+    std::string event = get_value(line, "event");
+    std::string formula = get_value(line, "formula");
+
+    if (event == "finished")
+      finished[formula]++;
+    else if (event == "progress")
+    {
+      progress++;
+      double percent = std::atof(get_value(line, "percent").c_str());
+      check(percent >= 0 && percent <= 100);
+    }
+    else if (event == "thread")
+    {
+      threadLines++;
+      check(formula == "D" && !get_value(line, "secs").empty());
+    }
+    else
+      check(false);
+  }
+
+  std::remove(filename.c_str());
+
+  std::cout << "progress events = " << progress;
+  check(progress >= 3);
+  std::cout << "thread events = " << threadLines;
+  check(threadLines >= 1);
+
+  // Nested formulas must not be reported
+  std::cout << "finished events = " << finished.size();
+  check(finished.size() == 4 &&
+        finished["pi_gourdon"] == 1 &&
+        finished["AC"] == 1 &&
+        finished["B"] == 1 &&
+        finished["D"] == 1);
+
+  std::cout << std::endl;
+  std::cout << "All tests passed successfully!" << std::endl;
+
+  return 0;
+}
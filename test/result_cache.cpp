@@ -0,0 +1,109 @@
+///
+/// @file   result_cache.cpp
+/// @brief  Test the persistent result cache (--cache-dir).
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <primecount.hpp>
+#include <primecount-internal.hpp>
+#include <ResultCache.hpp>
+
+#include <stdint.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace primecount;
+
+void check(bool OK)
+{
+  std::cout << "   " << (OK ? "OK" : "ERROR") << "\n";
+  if (!OK)
+    std::exit(1);
+}
+
+void append(const std::string& filename, const std::string& line)
+{
+  std::ofstream file(filename, std::ios::app);
+  file << line;
+}
+
+int read_line_count(const std::string& filename, const std::string& str)
+{
+  std::ifstream file(filename);
+  std::string line;
+  int count = 0;
+
+  while (std::getline(file, line))
+    count += (line == str);
+
+  return count;
+}
+
+int main()
+{
+  std::string filename = "./primecount-results.txt";
+  std::remove(filename.c_str());
+  set_cache_dir(".");
+
+  int64_t x = (int64_t) 1e11;
+  int64_t res = pi(x);
+  std::cout << "pi(" << x << ") = " << res;
+  check(res == 4118054813);
+
+  std::string value;
+  std::cout << "pi(" << x << ") stored in " << filename;
+  check(get_cached_result("pi(100000000000)", value) && value == "4118054813");
+
+  res = nth_prime(4118054813);
+  std::cout << "nth_prime(4118054813) = " << res;
+  check(res == 99999999977);
+  std::cout << "nth_prime(4118054813) is cached";
+  check(get_cached_result("nth_prime(4118054813)", value) && value == "99999999977");
+
+  // Results appended by another process
+  std::string version = PRIMECOUNT_VERSION;
+  append(filename, version + " pi(12345678901) = 42;\n");
+  res = pi(12345678901);
+  std::cout << "pi(12345678901) from cache file = " << res;
+  check(res == 42);
+
+  // Incomplete lines and other versions are ignored
+  append(filename, "0.1 pi(22345678901) = 43;\n");
+  append(filename, version + " pi(22345678901) = 4");
+  set_cache_dir("");
+  int64_t expected = pi(22345678901);
+  set_cache_dir(".");
+  res = pi(22345678901);
+  std::cout << "pi(22345678901) = " << res;
+  check(res == expected);
+
+  std::cout << "pi(22345678901) stored after incomplete line";
+  check(read_line_count(filename, version + " pi(22345678901) = " + std::to_string(expected) + ";") == 1);
+
+  // More results than fit into the in-process LRU cache,
+  // evicted results are found in the cache file.
+  for (int i = 0; i < 3000; i++)
+    append(filename, version + " pi(" + std::to_string(30000000000ll + i) + ") = " + std::to_string(i) + ";\n");
+
+  std::cout << "pi(30000002999) from cache file";
+  check(get_cached_result("pi(30000002999)", value) && value == "2999");
+  std::cout << "pi(30000000000) evicted from LRU cache";
+  check(get_cached_result("pi(30000000000)", value) && value == "0");
+  std::cout << "pi(30000001500) evicted from LRU cache";
+  check(get_cached_result("pi(30000001500)", value) && value == "1500");
+
+  set_cache_dir("");
+  std::remove(filename.c_str());
+
+  std::cout << std::endl;
+  std::cout << "All tests passed successfully!" << std::endl;
+
+  return 0;
+}
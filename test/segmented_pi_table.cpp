@@ -13,6 +13,7 @@
 #include <imath.hpp>
 
 #include <stdint.h>
+#include <algorithm>
 #include <iostream>
 #include <cstdlib>
 #include <random>
@@ -87,6 +88,22 @@ int main()
   std::cout << "segmentedPi(" << limit-1 << ") = " << segmentedPi[limit-1];
   check(segmentedPi[limit-1] == pi[limit-1]);
 
+  // Sieve segments using init_bits() and pass
+  // on PrimePi[high - 1] to the next segment
+  // like LoadBalancerAC does.
+  uint64_t pi_low = SegmentedPiTable::get_pi_low(0, threads);
+
+  for (low = 0; low < limit; low = high)
+  {
+    high = std::min(low + segment_size, limit);
+    uint64_t count = segmentedPi.init_bits(low, high);
+    segmentedPi.init_count(pi_low);
+    pi_low += count;
+
+    std::cout << "segmentedPi(" << high-1 << ") = " << segmentedPi[high-1];
+    check(segmentedPi[high-1] == pi[high-1]);
+  }
+
   std::cout << std::endl;
   std::cout << "All tests passed successfully!" << std::endl;
 
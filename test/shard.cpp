@@ -0,0 +1,122 @@
+///
+/// @file   shard.cpp
+/// @brief  Test distributed computing of the D, AC and S2_hard
+///         formulas. The sieving interval is split into N shards
+///         which are computed independently, afterwards the
+///         partial results (stored in the shards' backup files)
+///         are added up using merge_shards().
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <primecount.hpp>
+#include <primecount-internal.hpp>
+#include <backup.hpp>
+#include <gourdon.hpp>
+#include <imath.hpp>
+#include <PhiTiny.hpp>
+#include <S.hpp>
+
+#include <stdint.h>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace primecount;
+
+void check(bool OK)
+{
+  std::cout << "   " << (OK ? "OK" : "ERROR") << "\n";
+  if (!OK)
+    std::exit(1);
+}
+
+/// Compute all shards one after the other
+/// and merge their partial results.
+///
+template <typename F>
+int64_t sharded(int shards, F formula)
+{
+  std::vector<std::string> files;
+
+  for (int i = 0; i < shards; i++)
+  {
+    set_shard(i, shards);
+    set_backup_file(get_shard_backup_file());
+    files.push_back(get_backup_file());
+    formula();
+  }
+
+  set_shard(0, 1);
+  set_backup_file("");
+  int64_t sum = (int64_t) merge_shards(files);
+
+  for (const auto& file : files)
+    std::remove(file.c_str());
+
+  return sum;
+}
+
+int main()
+{
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  std::uniform_int_distribution<int64_t> dist(1000000, 1000000000000ll);
+  int threads = get_num_threads();
+  set_backup_interval(0);
+
+  for (int i = 0; i < 20; i++)
+  {
+    int64_t x = dist(gen);
+    int64_t x13 = iroot<3>(x);
+    int64_t sqrtx = isqrt(x);
+    int64_t y = std::min(x13 * 2, sqrtx - 1);
+    int64_t z = std::min(y * 2, sqrtx - 1);
+    int64_t k = PhiTiny::get_k(x);
+    int64_t c = PhiTiny::get_c(y);
+    int shards = 2 + i % 4;
+
+    int64_t d = D(x, y, z, k, (int64_t) Li(x), threads, false);
+    int64_t d_shards = sharded(shards, [&] { return D(x, y, z, k, (int64_t) Li(x), threads, false); });
+    std::cout << "D(" << x << ", " << y << ") = " << d << " (" << shards << " shards)";
+    check(d == d_shards);
+
+    int64_t ac = AC(x, y, z, k, threads, false);
+    int64_t ac_shards = sharded(shards, [&] { return AC(x, y, z, k, threads, false); });
+    std::cout << "AC(" << x << ", " << y << ") = " << ac << " (" << shards << " shards)";
+    check(ac == ac_shards);
+
+    int64_t s2 = S2_hard(x, y, x / y, c, (int64_t) Li(x), threads, false);
+    int64_t s2_shards = sharded(shards, [&] { return S2_hard(x, y, x / y, c, (int64_t) Li(x), threads, false); });
+    std::cout << "S2_hard(" << x << ", " << y << ") = " << s2 << " (" << shards << " shards)";
+    check(s2 == s2_shards);
+  }
+
+  // For x >= 1e17 the nested pi(low - 1) computations
+  // inside of AC(x) use Gourdon's algorithm, only the
+  // outermost AC(x) must be split into shards.
+  {
+    int64_t x = (int64_t) 1e17;
+    int64_t x13 = iroot<3>(x);
+    int64_t y = x13 * 10;
+    int64_t z = y * 2;
+    int64_t k = PhiTiny::get_k(x);
+    int shards = 2;
+
+    int64_t ac = AC(x, y, z, k, threads, false);
+    int64_t ac_shards = sharded(shards, [&] { return AC(x, y, z, k, threads, false); });
+    std::cout << "AC(" << x << ", " << y << ") = " << ac << " (" << shards << " shards)";
+    check(ac == ac_shards);
+  }
+
+  std::cout << std::endl;
+  std::cout << "All tests passed successfully!" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,98 @@
+///
+/// @file   sieve3.cpp
+/// @brief  Test Sieve::pre_sieve() using a sieve array that is
+///         larger than the L1 cache. In this case the small
+///         sieving primes are crossed off block by block.
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <Sieve.hpp>
+#include <generate.hpp>
+#include <imath.hpp>
+#include <primecount-config.hpp>
+
+#include <stdint.h>
+#include <algorithm>
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+#include <random>
+
+using std::size_t;
+using namespace primecount;
+
+void check(bool OK)
+{
+  std::cout << "   " << (OK ? "OK" : "ERROR") << "\n";
+  if (!OK)
+    std::exit(1);
+}
+
+int main()
+{
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  std::uniform_int_distribution<int> dist(3, 9);
+
+  // Sieve array of 3 to 9 blocks + a partial block
+  int64_t blocks = dist(gen);
+  int64_t segment_size = Sieve::get_segment_size(blocks * L1D_CACHE_SIZE * 30 + 240 * 7);
+  int64_t segments = 3;
+  int64_t high = segment_size * segments - 12345;
+
+  auto primes = generate_primes<int64_t>(isqrt(high));
+  std::vector<char> sieve2(high, 1);
+  sieve2[0] = 0;
+
+  // Pre-sieve using the small primes (crossed off
+  // block by block) and larger primes (crossed off
+  // one after the other).
+  uint64_t c = 1;
+  while (c + 1 < primes.size() && primes[c + 1] < L1D_CACHE_SIZE * 2)
+    c++;
+
+  for (uint64_t i = 1; i <= c; i++)
+    for (int64_t j = primes[i]; j < high; j += primes[i])
+      sieve2[j] = 0;
+
+  Sieve sieve(0, segment_size, primes.size());
+
+  for (int64_t low = 0; low < high; low += segment_size)
+  {
+    int64_t seg_high = std::min(low + segment_size, high);
+    sieve.pre_sieve(primes, c, low, seg_high);
+
+    uint64_t total = 0;
+    for (int64_t j = low; j < seg_high; j++)
+      total += sieve2[j];
+
+    std::cout << "sieve.get_total_count() = " << sieve.get_total_count();
+    check(total == sieve.get_total_count());
+
+    std::uniform_int_distribution<int64_t> dist2(0, seg_high - low - 1);
+
+    for (int i = 0; i < 100; i++)
+    {
+      int64_t start = dist2(gen);
+      int64_t stop = dist2(gen);
+      if (start > stop)
+        std::swap(start, stop);
+
+      uint64_t count = 0;
+      for (int64_t j = start; j <= stop; j++)
+        count += sieve2[low + j];
+
+      std::cout << "sieve.count(" << start << ", " << stop << ") = " << sieve.count(start, stop);
+      check(count == sieve.count(start, stop));
+    }
+  }
+
+  std::cout << std::endl;
+  std::cout << "All tests passed successfully!" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,91 @@
+///
+/// @file   sieve4.cpp
+/// @brief  Test Sieve::count(stop) with sparse leaves i.e. a large
+///         distance between consecutive count(stop) calls. After
+///         the first segment the Sieve measures the average leaf
+///         distance and switches to the two-level counter.
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <Sieve.hpp>
+#include <generate.hpp>
+#include <imath.hpp>
+
+#include <stdint.h>
+#include <algorithm>
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+#include <random>
+
+using std::size_t;
+using namespace primecount;
+
+void check(bool OK)
+{
+  std::cout << "   " << (OK ? "OK" : "ERROR") << "\n";
+  if (!OK)
+    std::exit(1);
+}
+
+int main()
+{
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  std::uniform_int_distribution<int64_t> dist(4000000, 6000000);
+
+  int64_t segment_size = Sieve::get_segment_size(1 << 25);
+  int64_t segments = 2;
+  int64_t high = segment_size * segments - 12345;
+
+  auto primes = generate_primes<int64_t>(isqrt(high));
+  std::vector<char> sieve2(high, 1);
+  sieve2[0] = 0;
+
+  // Primes <= 5 are crossed off by pre_sieve()
+  uint64_t c = 3;
+  uint64_t last = 12;
+
+  for (uint64_t i = 1; i <= c; i++)
+    for (int64_t j = primes[i]; j < high; j += primes[i])
+      sieve2[j] = 0;
+
+  Sieve sieve(0, segment_size, primes.size());
+
+  for (int64_t low = 0; low < high; low += segment_size)
+  {
+    int64_t seg_high = std::min(low + segment_size, high);
+    sieve.pre_sieve(primes, c, low, seg_high);
+
+    for (uint64_t i = c + 1; i <= last; i++)
+    {
+      sieve.cross_off_count(primes[i], i);
+      int64_t start = ceil_div(low, primes[i]) * primes[i];
+
+      for (int64_t j = start; j < seg_high; j += primes[i])
+        sieve2[j] = 0;
+
+      uint64_t count = 0;
+      int64_t j = low;
+
+      for (int64_t stop = dist(gen) % 1000; stop < seg_high - low; stop += dist(gen))
+      {
+        for (; j <= low + stop; j++)
+          count += sieve2[j];
+
+        uint64_t res = sieve.count(stop);
+        std::cout << "sieve.count(" << stop << ") = " << res;
+        check(count == res);
+      }
+    }
+  }
+
+  std::cout << std::endl;
+  std::cout << "All tests passed successfully!" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,83 @@
+///
+/// @file   sieve_popcnt.cpp
+/// @brief  Test the popcnt() kernels used by Sieve::count().
+///         At runtime Sieve::count() only uses the fastest
+///         kernel supported by the CPU, hence we call each
+///         kernel the CPU supports and compare its result
+///         against the portable popcnt_default() kernel.
+///
+/// Copyright (C) 2022 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <Sieve.hpp>
+#include <cpuid.hpp>
+
+#include <stdint.h>
+#include <algorithm>
+#include <iostream>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace primecount;
+
+void check(bool OK)
+{
+  std::cout << "   " << (OK ? "OK" : "ERROR") << "\n";
+  if (!OK)
+    std::exit(1);
+}
+
+template <typename Kernel>
+void test_kernel(const char* name, Kernel popcnt)
+{
+  std::random_device rd;
+  std::mt19937_64 gen(rd());
+  std::vector<uint64_t> data(1000);
+
+  for (auto& n : data)
+    n = gen();
+
+  // Sizes which are not a multiple of the vector
+  // width test the remaining words of each kernel.
+  for (uint64_t size = 0; size <= 100; size++)
+  {
+    std::uniform_int_distribution<uint64_t> dist(0, data.size() - size);
+    uint64_t i = dist(gen);
+    uint64_t cnt = popcnt(&data[i], size);
+    std::cout << name << "(data + " << i << ", " << size << ") = " << cnt;
+    check(cnt == Sieve::popcnt_default(&data[i], size));
+  }
+
+  uint64_t cnt = popcnt(&data[0], data.size());
+  std::cout << name << "(data, " << data.size() << ") = " << cnt;
+  check(cnt == Sieve::popcnt_default(&data[0], data.size()));
+
+  std::fill(data.begin(), data.end(), ~0ull);
+  cnt = popcnt(&data[0], data.size());
+  std::cout << name << "(~0, " << data.size() << ") = " << cnt;
+  check(cnt == data.size() * 64);
+}
+
+int main()
+{
+  test_kernel("popcnt_default", Sieve::popcnt_default);
+
+#if defined(ENABLE_MULTIARCH_AVX512_VPOPCNT)
+  if (has_cpuid_avx512_vpopcnt())
+    test_kernel("popcnt_avx512", Sieve::popcnt_avx512);
+#endif
+
+#if defined(ENABLE_MULTIARCH_AVX2)
+  if (has_cpuid_avx2())
+    test_kernel("popcnt_avx2", Sieve::popcnt_avx2);
+#endif
+
+  std::cout << std::endl;
+  std::cout << "All tests passed successfully!" << std::endl;
+
+  return 0;
+}